@@ -0,0 +1,114 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/**
+ * Helpers shared by the benchmarks: timing, random numbers and hardware
+ * counters.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static inline double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline unsigned int bench_rand(unsigned int *state)
+{
+    unsigned int x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * @return page faults taken by the process so far */
+static inline long long bench_page_faults(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt + ru.ru_majflt;
+}
+
+/**
+ * A hardware counter; fd is -1 when perf_event_open() is unavailable */
+typedef struct
+{
+    int fd;
+} bench_counter_t;
+
+static inline void bench_counter_open(bench_counter_t * c, uint32_t type,
+                                      uint64_t config)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    c->fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    (void)type;
+    (void)config;
+    c->fd = -1;
+#endif
+}
+
+static inline void bench_counter_close(bench_counter_t * c)
+{
+    if (-1 != c->fd)
+        close(c->fd);
+}
+
+static inline void bench_counter_start(bench_counter_t * c)
+{
+#ifdef __linux__
+    if (-1 == c->fd)
+        return;
+    ioctl(c->fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(c->fd, PERF_EVENT_IOC_ENABLE, 0);
+#else
+    (void)c;
+#endif
+}
+
+/**
+ * @return counter value since bench_counter_start(); -1 if unavailable */
+static inline long long bench_counter_stop(bench_counter_t * c)
+{
+    long long count = -1;
+
+#ifdef __linux__
+    if (-1 == c->fd)
+        return -1;
+    ioctl(c->fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (sizeof(count) != read(c->fd, &count, sizeof(count)))
+        return -1;
+#else
+    (void)c;
+#endif
+    return count;
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,134 @@
+/**
+ * Compares heap_t against the type-specialised heaps generated by
+ * HEAP_DEFINE and heap::heap on small integer keys.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+extern "C" {
+#include "heap.h"
+}
+#include "heap_define.h"
+#include "heap.hpp"
+
+#define uint_less(a, b) ((a) < (b))
+HEAP_DEFINE(uintheap, unsigned int, uint_less)
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const unsigned int *i1 = (const unsigned int *)e1;
+
+    const unsigned int *i2 = (const unsigned int *)e2;
+
+    return (*i2 > *i1) - (*i2 < *i1);
+}
+
+static double __now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void __report(const char *name, unsigned int n, double offer_ns,
+                     double poll_ns)
+{
+    printf("%10u %12s %12.1f %12.1f\n", n, name, offer_ns / n, poll_ns / n);
+}
+
+static void __bench_heap_t(unsigned int *keys, unsigned int n)
+{
+    heap_t *hp = heap_new(__uint_compare, NULL);
+    double start, offer_ns;
+    unsigned int ii;
+
+    start = __now();
+    for (ii = 0; ii < n; ii++)
+        heap_offer(&hp, &keys[ii]);
+    offer_ns = __now() - start;
+
+    start = __now();
+    for (ii = 0; ii < n; ii++)
+        heap_poll(hp);
+    __report("heap_t", n, offer_ns, __now() - start);
+
+    heap_free(hp);
+}
+
+static void __bench_heap_define(unsigned int *keys, unsigned int n)
+{
+    uintheap_t h;
+    double start, offer_ns;
+    unsigned int ii, val;
+
+    uintheap_init(&h);
+
+    start = __now();
+    for (ii = 0; ii < n; ii++)
+        uintheap_offer(&h, keys[ii]);
+    offer_ns = __now() - start;
+
+    start = __now();
+    for (ii = 0; ii < n; ii++)
+        uintheap_poll(&h, &val);
+    __report("HEAP_DEFINE", n, offer_ns, __now() - start);
+
+    uintheap_release(&h);
+}
+
+static void __bench_heap_hpp(unsigned int *keys, unsigned int n)
+{
+    heap::heap<unsigned int> h;
+    double start, offer_ns;
+    unsigned int ii, val;
+
+    start = __now();
+    for (ii = 0; ii < n; ii++)
+        h.offer(keys[ii]);
+    offer_ns = __now() - start;
+
+    start = __now();
+    for (ii = 0; ii < n; ii++)
+        h.poll(val);
+    __report("heap::heap", n, offer_ns, __now() - start);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int sizes[3] = { 1000, 1000000, 16000000 };
+    unsigned int max = 1 < argc ? strtoul(argv[1], NULL, 10) : 16000000;
+    unsigned int seed = 2463534242u;
+    unsigned int *keys;
+    unsigned int ii;
+
+    if (!(keys = (unsigned int *)malloc(max * sizeof(*keys))))
+        return 1;
+
+    for (ii = 0; ii < max; ii++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        keys[ii] = seed;
+    }
+
+    printf("%10s %12s %12s %12s\n", "items", "heap", "offer ns/op",
+           "poll ns/op");
+
+    for (ii = 0; ii < 3 && sizes[ii] <= max; ii++)
+    {
+        __bench_heap_t(keys, sizes[ii]);
+        __bench_heap_define(keys, sizes[ii]);
+        __bench_heap_hpp(keys, sizes[ii]);
+    }
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,863 @@
+/**
+ * Benchmark suite for heap.c and kheap.c
+ *
+ * Workloads:
+ *  build       n random items via heap_offer() vs. heap_new_from_array()
+ *  insert_mono n increasing keys
+ *  insert_rand n random keys
+ *  hold        poll then re-offer with a later key, at a steady size n
+ *              kheap, radixheap and vheap (SIMD and scalar) hold too
+ *  evict       mmheap hold that alternates polling both ends
+ *  remove_hit  heap_remove_item() of items in the heap
+ *  remove_miss heap_remove_item() of items not in the heap
+ *  evict_tenant remove the 1 in TENANTS items of one tenant;
+ *              heap_remove_item() of each vs. heap_remove_if(), with and
+ *              without index tracking
+ *  burst       offer BURST items then poll as many, at a steady size n;
+ *              heap_offer() with and without heap_set_offer_buffer()
+ *  burst_desc  burst with each key ahead of all the others, the worst case
+ *              for sifting up
+ *  timeout     arm and disarm timers at random, firing 1 in 20 and
+ *              disarming the rest; heap_remove_item() vs. heap_cancel()
+ *  drain       poll every item, one by one and with heap_poll_n()
+ *  decrease    raise random items' priority; heap_update_item() with index
+ *              tracking vs. pheap_decrease_key()
+ *  topk        keep the TOPK highest of n random keys; heap_offer() then
+ *              heap_poll() of the excess vs. heap_offer_bounded()
+ *  merge       merge MERGE_RUNS sorted runs of n items in total; heap_poll()
+ *              and heap_offer() of run heads vs. heap_replace() vs.
+ *              losertree with a callback and with uint64_t keys
+ *  restore     rebuild a kheap of n items by kheap_offer() vs. loading a
+ *              kheap_save() snapshot with kheap_map() and polling once
+ *
+ * Heap workloads also run with the blocked layout (heap_set_block_size()),
+ * as engines heap_b8 and heap_b512.
+ *
+ * Prints one CSV row per run with ns/op, comparisons/op, cache misses/op,
+ * page faults/op and dTLB load misses/op. Cache and TLB misses come from
+ * perf_event_open() and are left empty when it is unavailable;
+ * comparisons are empty for kheap and radixheap, which have no callback.
+ * Built without coverage instrumentation; see "make bench".
+ *
+ * Usage: bench_heap [max items]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "heap.h"
+#include "kheap.h"
+#include "radixheap.h"
+#include "pheap.h"
+#include "losertree.h"
+#include "mmheap.h"
+#include "vheap.h"
+#include "bench.h"
+
+/* ops for workloads that run at a steady size */
+#define STEADY_OPS 1000000
+
+/* items kept by the topk workload */
+#define TOPK 100
+
+/* runs merged by the merge workload */
+#define MERGE_RUNS 256
+
+/* items offered between polls by the burst workload */
+#define BURST 1000
+
+/* tenants whose items share the heap in the evict_tenant workload */
+#define TENANTS 16
+
+/* linear scans beyond this size take too long to be useful */
+#define SCAN_MAX 100000
+
+typedef struct
+{
+    unsigned int key;
+    size_t idx;
+    pheap_node_t node;
+} item_t;
+
+#define NODE_ITEM(n) ((const item_t *)((const char *)(n) - \
+                                       offsetof(item_t, node)))
+
+static unsigned long long cmps;
+
+static bench_counter_t misses;
+
+static bench_counter_t tlb_misses;
+
+static long long faults;
+
+static double start;
+
+static unsigned int seed = 2463534242u;
+
+static int __item_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const item_t *i1 = e1;
+
+    const item_t *i2 = e2;
+
+    cmps++;
+    return (i2->key > i1->key) - (i2->key < i1->key);
+}
+
+static int __node_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata
+    )
+{
+    return __item_compare(NODE_ITEM(e1), NODE_ITEM(e2), udata);
+}
+
+static void __begin(void)
+{
+    cmps = 0;
+    faults = bench_page_faults();
+    bench_counter_start(&misses);
+    bench_counter_start(&tlb_misses);
+    start = bench_now();
+}
+
+static void __end(const char *workload, const char *engine,
+                  unsigned int arity, unsigned int n, unsigned int ops,
+                  int has_cmp)
+{
+    double ns = bench_now() - start;
+    long long m = bench_counter_stop(&misses);
+    long long t = bench_counter_stop(&tlb_misses);
+    long long f = bench_page_faults() - faults;
+
+    if (0 == ops)
+        ops = 1;
+
+    printf("%s,%s,%u,%u,%u,%.1f,", workload, engine, arity, n, ops, ns / ops);
+    if (has_cmp)
+        printf("%.2f", (double)cmps / ops);
+    printf(",");
+    if (-1 != m)
+        printf("%.2f", (double)m / ops);
+    printf(",%.4f,", (double)f / ops);
+    if (-1 != t)
+        printf("%.2f", (double)t / ops);
+    printf("\n");
+    fflush(stdout);
+}
+
+static const char *__engine(const char *name, unsigned int block)
+{
+    static char buf[64];
+
+    if (0 == block)
+        return name;
+
+    snprintf(buf, sizeof(buf), "%s_b%u", name, block);
+    return buf;
+}
+
+/**
+ * @param[in] block Block size for the blocked layout; 0 for the standard
+ *  layout */
+static heap_t *__new_heap(unsigned int arity, int track, unsigned int block)
+{
+    heap_t *hp = heap_new(__item_compare, NULL);
+
+    heap_set_arity(hp, arity);
+    heap_set_block_size(hp, block);
+    if (track)
+        heap_set_item_idx_offset(hp, offsetof(item_t, idx));
+    return hp;
+}
+
+static void __fill(heap_t ** hp, item_t *items, unsigned int n)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < n; ii++)
+        heap_offer(hp, &items[ii]);
+}
+
+static void __randomise(item_t *items, unsigned int n)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < n; ii++)
+        items[ii].key = bench_rand(&seed);
+}
+
+static void __bench_build(item_t *items, void **ptrs, unsigned int n)
+{
+    heap_t *hp = __new_heap(2, 0, 0);
+    unsigned int ii;
+
+    __randomise(items, n);
+    for (ii = 0; ii < n; ii++)
+        ptrs[ii] = &items[ii];
+
+    __begin();
+    __fill(&hp, items, n);
+    __end("build", "heap_offer", 2, n, n, 1);
+    heap_free(hp);
+
+    __begin();
+    hp = heap_new_from_array(__item_compare, NULL, ptrs, n);
+    __end("build", "from_array", 2, n, n, 1);
+    heap_free(hp);
+}
+
+static void __bench_insert(item_t *items, unsigned int n, unsigned int arity,
+                           unsigned int block)
+{
+    heap_t *hp = __new_heap(arity, 0, block);
+    unsigned int ii;
+
+    for (ii = 0; ii < n; ii++)
+        items[ii].key = ii;
+
+    __begin();
+    __fill(&hp, items, n);
+    __end("insert_mono", __engine("heap", block), arity, n, n, 1);
+    heap_free(hp);
+
+    hp = __new_heap(arity, 0, block);
+    __randomise(items, n);
+
+    __begin();
+    __fill(&hp, items, n);
+    __end("insert_rand", __engine("heap", block), arity, n, n, 1);
+    heap_free(hp);
+}
+
+static void __bench_hold(item_t *items, unsigned int n, unsigned int arity,
+                         unsigned int block)
+{
+    heap_t *hp = __new_heap(arity, 0, block);
+    unsigned int ii;
+
+    __randomise(items, n);
+    for (ii = 0; ii < n; ii++)
+        items[ii].key >>= 1;
+    __fill(&hp, items, n);
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        item_t *item = heap_poll(hp);
+
+        item->key += bench_rand(&seed) >> 12;
+        heap_offer(&hp, item);
+    }
+    __end("hold", __engine("heap", block), arity, n, STEADY_OPS, 1);
+
+    heap_free(hp);
+}
+
+static void __bench_hold_kheap(unsigned int n)
+{
+    kheap_t *hp = kheap_new();
+    unsigned int ii;
+
+    for (ii = 0; ii < n; ii++)
+        kheap_offer(&hp, bench_rand(&seed) >> 1, NULL);
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        uint64_t key;
+
+        kheap_poll(hp, &key);
+        kheap_offer(&hp, key + (bench_rand(&seed) >> 12), NULL);
+    }
+    __end("hold", "kheap", 4, n, STEADY_OPS, 0);
+
+    kheap_free(hp);
+}
+
+static void __bench_vheap(unsigned int n, unsigned int arity, int simd)
+{
+    const char *engine = simd ? "vheap" : "vheap_scalar";
+    vheap_t *hp = vheap_new(arity);
+    unsigned int ii;
+
+    if (-1 == vheap_set_simd(hp, simd))
+    {
+        vheap_free(hp);
+        return;
+    }
+
+    for (ii = 0; ii < n; ii++)
+        vheap_offer(hp, bench_rand(&seed) >> 1, NULL);
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        uint32_t key;
+
+        vheap_poll(hp, &key);
+        vheap_offer(hp, key + (bench_rand(&seed) >> 12), NULL);
+    }
+    __end("hold", engine, arity, n, STEADY_OPS, 0);
+
+    __begin();
+    for (ii = 0; ii < n; ii++)
+        vheap_poll(hp, NULL);
+    __end("drain", engine, arity, n, n, 0);
+
+    vheap_free(hp);
+}
+
+static void __bench_hold_radixheap(unsigned int n)
+{
+    radixheap_t *hp = radixheap_new();
+    unsigned int ii;
+
+    for (ii = 0; ii < n; ii++)
+        radixheap_offer(hp, bench_rand(&seed) >> 1, NULL);
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        uint64_t key;
+
+        radixheap_poll(hp, &key);
+        radixheap_offer(hp, key + (bench_rand(&seed) >> 12), NULL);
+    }
+    __end("hold", "radixheap", 0, n, STEADY_OPS, 0);
+
+    radixheap_free(hp);
+}
+
+static void __bench_hold_mmheap(item_t *items, unsigned int n)
+{
+    mmheap_t *hp = mmheap_new(__item_compare, NULL);
+    unsigned int ii;
+
+    __randomise(items, n);
+    for (ii = 0; ii < n; ii++)
+    {
+        items[ii].key >>= 1;
+        mmheap_offer(&hp, &items[ii]);
+    }
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        item_t *item = mmheap_poll_max(hp);
+
+        item->key += bench_rand(&seed) >> 12;
+        mmheap_offer(&hp, item);
+    }
+    __end("hold", "mmheap", 2, n, STEADY_OPS, 1);
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        item_t *item = ii & 1 ? mmheap_poll_min(hp) : mmheap_poll_max(hp);
+
+        item->key = bench_rand(&seed) >> 1;
+        mmheap_offer(&hp, item);
+    }
+    __end("evict", "mmheap", 2, n, STEADY_OPS, 1);
+
+    mmheap_free(hp);
+}
+
+static void __bench_remove(item_t *items, unsigned int n, int track)
+{
+    const char *engine = track ? "tracked" : "scan";
+    unsigned int ii, ops = n < 1000 ? n : 1000;
+    item_t missing;
+    heap_t *hp;
+
+    /* keys are odd so that the missing item never matches a scan */
+    missing.key = 0;
+    missing.idx = 0;
+    for (ii = 0; ii < n; ii++)
+        items[ii].key = bench_rand(&seed) % n * 2 + 1;
+
+    hp = __new_heap(2, track, 0);
+    __fill(&hp, items, n);
+
+    __begin();
+    for (ii = 0; ii < ops; ii++)
+        heap_remove_item(hp, &missing);
+    __end("remove_miss", engine, 2, n, ops, 1);
+
+    __begin();
+    for (ii = 0; ii < ops; ii++)
+        heap_remove_item(hp, &items[ii]);
+    __end("remove_hit", engine, 2, n, ops, 1);
+
+    heap_free(hp);
+}
+
+static void __bench_burst(item_t *items, unsigned int n, int buffer,
+                          int desc)
+{
+    const char *engine = buffer ? "heap_buffered" : "heap";
+    /* descending keys count down from the middle */
+    unsigned int ii, jj, key = desc ? 1u << 31 : 0;
+    item_t **polled = malloc(BURST * sizeof(*polled));
+    heap_t *hp;
+
+    if (!polled)
+        return;
+
+    hp = __new_heap(2, 0, 0);
+    if (buffer)
+        heap_set_offer_buffer(hp, BURST);
+    for (ii = 0; ii < n; ii++)
+    {
+        items[ii].key = key + bench_rand(&seed) % n;
+        heap_offer(&hp, &items[ii]);
+    }
+    for (ii = 0; ii < BURST; ii++)
+        polled[ii] = heap_poll(hp);
+
+    /* re-offer what the last burst polled, with new keys */
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii += BURST)
+    {
+        for (jj = 0; jj < BURST; jj++)
+        {
+            polled[jj]->key = desc ? --key : key + bench_rand(&seed) % n;
+            heap_offer(&hp, polled[jj]);
+        }
+        for (jj = 0; jj < BURST; jj++)
+            polled[jj] = heap_poll(hp);
+        if (!desc)
+            key += BURST;
+    }
+    __end(desc ? "burst_desc" : "burst", engine, 2, n, STEADY_OPS, 1);
+
+    heap_free(hp);
+    free(polled);
+}
+
+static int __is_tenant(const void *item, const void *udata)
+{
+    return ((const item_t *)item)->key % TENANTS ==
+           *(const unsigned int *)udata;
+}
+
+static unsigned int __tenant_items(item_t *items, unsigned int n,
+                                   unsigned int tenant)
+{
+    unsigned int ii, count = 0;
+
+    for (ii = 0; ii < n; ii++)
+        count += __is_tenant(&items[ii], &tenant);
+    return count;
+}
+
+static void __bench_evict_tenant(item_t *items, unsigned int n, int track)
+{
+    const char *engine = track ? "heap_remove_item" : "heap_remove_item_scan";
+    unsigned int ii, ops, tenant = 0;
+    heap_t *hp = __new_heap(2, track, 0);
+
+    __randomise(items, n);
+    __fill(&hp, items, n);
+    ops = __tenant_items(items, n, tenant);
+
+    __begin();
+    for (ii = 0; ii < n; ii++)
+        if (__is_tenant(&items[ii], &tenant))
+            heap_remove_item(hp, &items[ii]);
+    __end("evict_tenant", engine, 2, n, ops, 1);
+
+    tenant = 1;
+    ops = __tenant_items(items, n, tenant);
+
+    __begin();
+    heap_remove_if(hp, __is_tenant, &tenant, NULL);
+    __end("evict_tenant", track ? "heap_remove_if" : "heap_remove_if_scan",
+          2, n, ops, 1);
+
+    heap_free(hp);
+}
+
+static void __bench_timeout(item_t *items, unsigned int n, int cancel)
+{
+    const char *engine = cancel ? "heap_cancel" : "heap_remove_item";
+    unsigned int ii, now = 0;
+    char *armed = calloc(n, 1);
+    heap_t *hp;
+
+    if (!armed)
+        return;
+
+    hp = __new_heap(2, 1, 0);
+    for (ii = 0; ii < n; ii++)
+        items[ii].key = 0;
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        unsigned int r = bench_rand(&seed), jj = r % n;
+
+        now++;
+        if (!armed[jj])
+        {
+            items[jj].key = now + r % n;
+            heap_offer(&hp, &items[jj]);
+            armed[jj] = 1;
+        }
+        else if (0 == r / n % 20)
+        {
+            armed[(item_t *)heap_poll(hp) - items] = 0;
+        }
+        else
+        {
+            if (cancel)
+                heap_cancel(hp, &items[jj]);
+            else
+                heap_remove_item(hp, &items[jj]);
+            armed[jj] = 0;
+        }
+    }
+    __end("timeout", engine, 2, n, STEADY_OPS, 1);
+
+    heap_free(hp);
+    free(armed);
+}
+
+static void __bench_drain(item_t *items, void **out, unsigned int n,
+                          unsigned int arity, unsigned int block)
+{
+    heap_t *hp = __new_heap(arity, 0, block);
+    unsigned int ii;
+
+    __randomise(items, n);
+    __fill(&hp, items, n);
+
+    __begin();
+    for (ii = 0; ii < n; ii++)
+        heap_poll(hp);
+    __end("drain", __engine("heap_poll", block), arity, n, n, 1);
+
+    __fill(&hp, items, n);
+
+    __begin();
+    while (0 < heap_poll_n(hp, out, 256))
+        ;
+    __end("drain", __engine("heap_poll_n", block), arity, n, n, 1);
+
+    heap_free(hp);
+}
+
+static void __bench_topk(item_t *items, unsigned int n)
+{
+    heap_t *hp = __new_heap(2, 0, 0);
+    unsigned int ii;
+
+    __randomise(items, n);
+
+    __begin();
+    for (ii = 0; ii < n; ii++)
+    {
+        heap_offer(&hp, &items[ii]);
+        if (TOPK < heap_count(hp))
+            heap_poll(hp);
+    }
+    __end("topk", "heap_offer", 2, n, n, 1);
+    heap_free(hp);
+
+    hp = heap_new_bounded(__item_compare, NULL, TOPK);
+
+    __begin();
+    for (ii = 0; ii < n; ii++)
+        heap_offer_bounded(hp, &items[ii]);
+    __end("topk", "offer_bounded", 2, n, n, 1);
+    heap_free(hp);
+}
+
+typedef struct
+{
+    void *vals;
+    size_t width;
+    unsigned int n;
+    unsigned int pos;
+} bench_run_t;
+
+static void *__run_next(void *r)
+{
+    bench_run_t *run = r;
+
+    if (run->pos == run->n)
+        return NULL;
+    return (char *)run->vals + run->width * run->pos++;
+}
+
+/**
+ * Split the array into MERGE_RUNS sorted runs */
+static void __make_runs(bench_run_t *runs, void **ptrs, void *vals,
+                        size_t width, unsigned int n)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < MERGE_RUNS; ii++)
+    {
+        unsigned int first = (unsigned long long)n * ii / MERGE_RUNS;
+
+        runs[ii].vals = (char *)vals + width * first;
+        runs[ii].width = width;
+        runs[ii].n = (unsigned long long)n * (ii + 1) / MERGE_RUNS - first;
+        runs[ii].pos = 0;
+        ptrs[ii] = &runs[ii];
+    }
+}
+
+static void __bench_merge_heap(item_t *items, unsigned int n, int replace)
+{
+    bench_run_t runs[MERGE_RUNS];
+    void *ptrs[MERGE_RUNS];
+    heap_t *hp = __new_heap(2, 0, 0);
+    unsigned int ii;
+    item_t *item;
+
+    __make_runs(runs, ptrs, items, sizeof(item_t), n);
+
+    __begin();
+    /* items remember their run in idx */
+    for (ii = 0; ii < MERGE_RUNS; ii++)
+        if ((item = __run_next(&runs[ii])))
+        {
+            item->idx = ii;
+            heap_offer(&hp, item);
+        }
+
+    while ((item = heap_peek(hp)))
+    {
+        item_t *next = __run_next(&runs[item->idx]);
+
+        if (!next)
+            heap_poll(hp);
+        else
+        {
+            next->idx = item->idx;
+            if (replace)
+                heap_replace(hp, next);
+            else
+            {
+                heap_poll(hp);
+                heap_offer(&hp, next);
+            }
+        }
+    }
+    __end("merge", replace ? "heap_replace" : "heap", 2, n, n, 1);
+
+    heap_free(hp);
+}
+
+static void __bench_merge(item_t *items, unsigned int n)
+{
+    bench_run_t runs[MERGE_RUNS];
+    void *ptrs[MERGE_RUNS];
+    uint64_t *keys;
+    losertree_t *lt;
+    unsigned int ii;
+
+    if (!(keys = malloc(n * sizeof(*keys))))
+        return;
+
+    for (ii = 0; ii < n; ii++)
+        items[ii].key = keys[ii] = ii % (n / MERGE_RUNS + 1);
+
+    __bench_merge_heap(items, n, 0);
+    __bench_merge_heap(items, n, 1);
+
+    __make_runs(runs, ptrs, items, sizeof(item_t), n);
+    __begin();
+    lt = losertree_new(__item_compare, NULL, __run_next, ptrs, MERGE_RUNS);
+    while (losertree_poll(lt))
+        ;
+    __end("merge", "losertree", 2, n, n, 1);
+    losertree_free(lt);
+
+    __make_runs(runs, ptrs, keys, sizeof(*keys), n);
+    __begin();
+    lt = losertree_new_u64(0, __run_next, ptrs, MERGE_RUNS);
+    while (losertree_poll(lt))
+        ;
+    __end("merge", "losertree_u64", 2, n, n, 0);
+    losertree_free(lt);
+
+    free(keys);
+}
+
+static void __bench_decrease(item_t *items, unsigned int n)
+{
+    heap_t *hp = __new_heap(2, 1, 0);
+    pheap_t *php;
+    unsigned int ii;
+
+    __randomise(items, n);
+    __fill(&hp, items, n);
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        item_t *item = &items[bench_rand(&seed) % n];
+
+        item->key >>= 1;
+        heap_update_item(hp, item);
+    }
+    __end("decrease", "heap_tracked", 2, n, STEADY_OPS, 1);
+
+    heap_free(hp);
+
+    php = pheap_new(__node_compare, NULL);
+    __randomise(items, n);
+    for (ii = 0; ii < n; ii++)
+        pheap_offer(php, &items[ii].node);
+
+    __begin();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        item_t *item = &items[bench_rand(&seed) % n];
+
+        item->key >>= 1;
+        pheap_decrease_key(php, &item->node);
+    }
+    __end("decrease", "pheap", 0, n, STEADY_OPS, 1);
+
+    pheap_free(php);
+}
+
+static void __bench_drain_kheap(unsigned int n)
+{
+    kheap_t *hp = kheap_new();
+    unsigned int ii;
+
+    for (ii = 0; ii < n; ii++)
+        kheap_offer(&hp, bench_rand(&seed), NULL);
+
+    __begin();
+    for (ii = 0; ii < n; ii++)
+        kheap_poll(hp, NULL);
+    __end("drain", "kheap", 4, n, n, 0);
+
+    kheap_free(hp);
+}
+
+static void __bench_restore_kheap(unsigned int n)
+{
+    char path[] = "/tmp/bench_kheap_XXXXXX";
+    kheap_t *hp = kheap_new();
+    unsigned int ii;
+    int fd;
+
+    __begin();
+    for (ii = 0; ii < n; ii++)
+        kheap_offer(&hp, bench_rand(&seed), (void *)(uintptr_t)ii);
+    __end("restore", "kheap_offer", 4, n, n, 0);
+
+    if (-1 == (fd = mkstemp(path)))
+    {
+        kheap_free(hp);
+        return;
+    }
+    kheap_save(hp, fd);
+    close(fd);
+    kheap_free(hp);
+
+    __begin();
+    hp = kheap_map(path);
+    kheap_poll(hp, NULL);
+    __end("restore", "kheap_map", 4, n, n, 0);
+
+    kheap_free(hp);
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int arities[3] = { 2, 4, 8 };
+    unsigned int blocks[2] = { 8, 512 };
+    unsigned int max = 1 < argc ? strtoul(argv[1], NULL, 10) : 10000000;
+    unsigned int n, ii;
+    item_t *items;
+    void **ptrs;
+
+    items = malloc(max * sizeof(*items));
+    ptrs = malloc(max * sizeof(*ptrs));
+    if (!items || !ptrs)
+        return 1;
+
+    bench_counter_open(&misses, PERF_TYPE_HARDWARE,
+                       PERF_COUNT_HW_CACHE_MISSES);
+    bench_counter_open(&tlb_misses, PERF_TYPE_HW_CACHE,
+                       PERF_COUNT_HW_CACHE_DTLB |
+                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+    printf("workload,engine,arity,items,ops,ns_per_op,cmps_per_op,"
+           "cache_misses_per_op,page_faults_per_op,dtlb_misses_per_op\n");
+
+    for (n = 10; n <= max; n *= 10)
+    {
+        __bench_build(items, ptrs, n);
+
+        for (ii = 0; ii < 3; ii++)
+        {
+            __bench_insert(items, n, arities[ii], 0);
+            __bench_hold(items, n, arities[ii], 0);
+            __bench_drain(items, ptrs, n, arities[ii], 0);
+        }
+
+        for (ii = 0; ii < 2; ii++)
+        {
+            __bench_insert(items, n, 2, blocks[ii]);
+            __bench_hold(items, n, 2, blocks[ii]);
+            __bench_drain(items, ptrs, n, 2, blocks[ii]);
+        }
+
+        __bench_hold_kheap(n);
+        __bench_hold_radixheap(n);
+        __bench_hold_mmheap(items, n);
+        for (ii = 0; ii < 3; ii++)
+        {
+            __bench_vheap(n, 4 << ii, 1);
+            __bench_vheap(n, 4 << ii, 0);
+        }
+        __bench_drain_kheap(n);
+        __bench_restore_kheap(n);
+
+        __bench_decrease(items, n);
+        __bench_topk(items, n);
+        if (MERGE_RUNS <= n)
+            __bench_merge(items, n);
+
+        __bench_remove(items, n, 1);
+        if (BURST <= n)
+        {
+            for (ii = 0; ii < 2; ii++)
+            {
+                __bench_burst(items, n, 0, ii);
+                __bench_burst(items, n, 1, ii);
+            }
+        }
+        __bench_evict_tenant(items, n, 1);
+        if (n <= SCAN_MAX)
+            __bench_evict_tenant(items, n, 0);
+        __bench_timeout(items, n, 0);
+        __bench_timeout(items, n, 1);
+        if (n <= SCAN_MAX)
+            __bench_remove(items, n, 0);
+    }
+
+    bench_counter_close(&misses);
+    bench_counter_close(&tlb_misses);
+    free(items);
+    free(ptrs);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * Tail latency of heap_offer() while a heap grows from empty.
+ *
+ * A heap from heap_new() is occasionally realloc()ed and copied as it
+ * grows; one from heap_new_reserved() never moves, and can also be backed
+ * by transparent huge pages. Each offer is timed individually and the
+ * percentiles are printed as CSV.
+ *
+ * Usage: bench_latency [items]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "heap.h"
+#include "heap_vm.h"
+#include "bench.h"
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const unsigned int *i1 = e1;
+
+    const unsigned int *i2 = e2;
+
+    return (*i2 > *i1) - (*i2 < *i1);
+}
+
+static int __double_cmp(const void *a, const void *b)
+{
+    const double *d1 = a, *d2 = b;
+
+    return (*d1 > *d2) - (*d1 < *d2);
+}
+
+static void __report(const char *engine, double *lat, unsigned int n)
+{
+    qsort(lat, n, sizeof(*lat), __double_cmp);
+
+    printf("%s,%u,%.0f,%.0f,%.0f,%.0f\n", engine, n, lat[n / 2],
+           lat[(size_t)n * 99 / 100], lat[(size_t)n * 999 / 1000], lat[n - 1]);
+}
+
+static void __run(const char *engine, heap_t *hp, unsigned int *keys,
+                  double *lat, unsigned int n)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < n; ii++)
+    {
+        double start = bench_now();
+
+        heap_offer(&hp, &keys[ii]);
+        lat[ii] = bench_now() - start;
+    }
+
+    heap_free(hp);
+    __report(engine, lat, n);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int n = 1 < argc ? strtoul(argv[1], NULL, 10) : 10000000;
+    unsigned int seed = 2463534242u;
+    unsigned int *keys;
+    double *lat;
+    unsigned int ii;
+
+    keys = malloc(n * sizeof(*keys));
+    lat = malloc(n * sizeof(*lat));
+    if (!keys || !lat)
+        return 1;
+
+    for (ii = 0; ii < n; ii++)
+        keys[ii] = bench_rand(&seed);
+
+    printf("engine,items,p50_ns,p99_ns,p999_ns,max_ns\n");
+
+    __run("heap_new", heap_new(__uint_compare, NULL), keys, lat, n);
+    __run("heap_new_reserved", heap_new_reserved(__uint_compare, NULL, n),
+          keys, lat, n);
+    __run("heap_new_reserved_huge",
+          heap_new_reserved_ex(__uint_compare, NULL, n, HEAP_VM_HUGEPAGES),
+          keys, lat, n);
+
+    free(keys);
+    free(lat);
+    return 0;
+}
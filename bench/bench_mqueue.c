@@ -0,0 +1,141 @@
+/**
+ * Multithreaded throughput of mqueue_t versus a heap_t behind one mutex.
+ *
+ * Every thread repeatedly offers an item and then polls one, keeping the
+ * queue at a steady size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "heap.h"
+#include "mqueue.h"
+
+#define PREFILL 100000
+#define OPS_PER_THREAD 1000000
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const unsigned int *i1 = e1;
+
+    const unsigned int *i2 = e2;
+
+    return (*i2 > *i1) - (*i2 < *i1);
+}
+
+static double __now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned int *keys;
+
+static mqueue_t *mq;
+
+static heap_t *locked_heap;
+
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *__run_mqueue(void *arg)
+{
+    unsigned int ii, base = (size_t)arg * OPS_PER_THREAD;
+
+    for (ii = 0; ii < OPS_PER_THREAD; ii++)
+    {
+        mqueue_offer(mq, &keys[base + ii]);
+        mqueue_poll(mq);
+    }
+
+    return NULL;
+}
+
+static void *__run_locked_heap(void *arg)
+{
+    unsigned int ii, base = (size_t)arg * OPS_PER_THREAD;
+
+    for (ii = 0; ii < OPS_PER_THREAD; ii++)
+    {
+        pthread_mutex_lock(&heap_lock);
+        heap_offer(&locked_heap, &keys[base + ii]);
+        pthread_mutex_unlock(&heap_lock);
+
+        pthread_mutex_lock(&heap_lock);
+        heap_poll(locked_heap);
+        pthread_mutex_unlock(&heap_lock);
+    }
+
+    return NULL;
+}
+
+static double __run(void *(*fn) (void *), unsigned int nthreads)
+{
+    pthread_t threads[64];
+    double start;
+    size_t ii;
+
+    start = __now();
+    for (ii = 0; ii < nthreads; ii++)
+        pthread_create(&threads[ii], NULL, fn, (void *)ii);
+    for (ii = 0; ii < nthreads; ii++)
+        pthread_join(threads[ii], NULL);
+
+    /* million operations per second; an offer and a poll are two ops */
+    return 2.0 * nthreads * OPS_PER_THREAD / (__now() - start) * 1e3;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int max_threads = 1 < argc ? strtoul(argv[1], NULL, 10) : 8;
+    unsigned int seed = 2463534242u;
+    unsigned int ii, nthreads;
+
+    if (64 < max_threads)
+        max_threads = 64;
+
+    keys = malloc((PREFILL + max_threads * OPS_PER_THREAD) * sizeof(*keys));
+    if (!keys)
+        return 1;
+
+    for (ii = 0; ii < PREFILL + max_threads * OPS_PER_THREAD; ii++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        keys[ii] = seed;
+    }
+
+    printf("%8s %16s %16s\n", "threads", "locked Mops/s", "mqueue Mops/s");
+
+    for (nthreads = 1; nthreads <= max_threads; nthreads *= 2)
+    {
+        double locked_mops, mqueue_mops;
+
+        locked_heap = heap_new(__uint_compare, NULL);
+        mq = mqueue_new(__uint_compare, NULL, nthreads * 4);
+
+        for (ii = 0; ii < PREFILL; ii++)
+        {
+            heap_offer(&locked_heap, &keys[max_threads * OPS_PER_THREAD + ii]);
+            mqueue_offer(mq, &keys[max_threads * OPS_PER_THREAD + ii]);
+        }
+
+        locked_mops = __run(__run_locked_heap, nthreads);
+        mqueue_mops = __run(__run_mqueue, nthreads);
+        printf("%8u %16.2f %16.2f\n", nthreads, locked_mops, mqueue_mops);
+
+        heap_free(locked_heap);
+        mqueue_free(mq);
+    }
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * Effect of prefetching in the sift loops, at sizes from in-L1 to beyond
+ * the last level cache.
+ *
+ * Items are scattered in memory relative to their heap positions and cmp
+ * reads a key from each item, so every level of a sift can miss twice:
+ * once on the array and once on the item. Engines:
+ *  heap       array prefetching only
+ *  heap_hook  array prefetching plus a heap_set_prefetch() item hook
+ *
+ * "make bench" also builds this with -DHEAP_NO_PREFETCH as
+ * bench_prefetch_off, whose engines are suffixed _off, for a baseline.
+ *
+ * Usage: bench_prefetch [max items]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "heap.h"
+#include "bench.h"
+
+#ifdef HEAP_NO_PREFETCH
+#define SUFFIX "_off"
+#else
+#define SUFFIX ""
+#endif
+
+#define STEADY_OPS 1000000
+
+typedef struct
+{
+    unsigned int key;
+    /* make items a cache line each, as in typical schedulers */
+    char payload[60];
+} item_t;
+
+static unsigned int seed = 2463534242u;
+
+static int __item_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const item_t *i1 = e1;
+
+    const item_t *i2 = e2;
+
+    return (i2->key > i1->key) - (i2->key < i1->key);
+}
+
+static void __item_prefetch(const void *item,
+                            const void *udata __attribute__((__unused__)))
+{
+    __builtin_prefetch(item);
+}
+
+static void __run(item_t *items, unsigned int n, int hook)
+{
+    const char *engine = hook ? "heap_hook" SUFFIX : "heap" SUFFIX;
+    heap_t *hp = heap_new(__item_compare, NULL);
+    unsigned int ii;
+    double start;
+
+    if (hook)
+        heap_set_prefetch(hp, __item_prefetch);
+
+    for (ii = 0; ii < n; ii++)
+    {
+        items[ii].key = bench_rand(&seed) >> 1;
+        heap_offer(&hp, &items[ii]);
+    }
+
+    start = bench_now();
+    for (ii = 0; ii < STEADY_OPS; ii++)
+    {
+        item_t *item = heap_poll(hp);
+
+        item->key += bench_rand(&seed) >> 12;
+        heap_offer(&hp, item);
+    }
+    printf("hold,%s,%u,%.1f\n", engine, n, (bench_now() - start) / STEADY_OPS);
+
+    start = bench_now();
+    for (ii = 0; ii < n; ii++)
+        heap_poll(hp);
+    printf("drain,%s,%u,%.1f\n", engine, n, (bench_now() - start) / n);
+    fflush(stdout);
+
+    heap_free(hp);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int max = 1 < argc ? strtoul(argv[1], NULL, 10) : 10000000;
+    unsigned int n;
+    item_t *items;
+
+    if (!(items = malloc((size_t)max * sizeof(*items))))
+        return 1;
+
+    printf("workload,engine,items,ns_per_op\n");
+
+    for (n = 1000; n <= max; n *= 10)
+    {
+        __run(items, n, 0);
+        __run(items, n, 1);
+    }
+
+    free(items);
+    return 0;
+}
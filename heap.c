@@ -1,43 +1,187 @@
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <strings.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "heap.h"
 
 #define DEFAULT_CAPACITY 13
 
+/* compact once more than this share of the array is cancelled items */
+#define DEFAULT_TOMBSTONE_RATIO 0.25
+
+/* heap_update_many() rebuilds the heap for more items than this */
+#define UPDATE_MANY_SIFTS 32
+
+/* top bit of a tracked index; set while the item is cancelled */
+#define DEAD ((size_t)1 << (sizeof(size_t) * CHAR_BIT - 1))
+
+#ifdef HEAP_STATS
+/* stats are bookkeeping, so they are also updated through const heaps */
+#define STAT_ADD(h, field, n) (((heap_t *)(h))->stats.field += (n))
+#define STAT_HIGH_WATER(h) \
+    do { \
+        if ((h)->stats.high_water < (h)->count + (h)->buffered) \
+            (h)->stats.high_water = (h)->count + (h)->buffered; \
+    } while (0)
+#else
+#define STAT_ADD(h, field, n)
+#define STAT_HIGH_WATER(h)
+#endif
+#define STAT_INC(h, field) STAT_ADD(h, field, 1)
+
+#if defined(__GNUC__) && !defined(HEAP_NO_PREFETCH)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) do { } while (0)
+#endif
+
+/* below this many slots the heap and its items are likely cached, and
+ * fetching ahead only costs */
+#ifndef HEAP_PREFETCH_MIN
+#define HEAP_PREFETCH_MIN (1 << 14)
+#endif
+
 struct heap_s
 {
     /* size of array */
-    unsigned int size;
-    /* items within heap */
-    unsigned int count;
+    size_t size;
+    /* items within heap, including cancelled ones */
+    size_t count;
+    /* cancelled items still in the array; never the top item */
+    size_t dead;
+    /* offered items waiting after the heap's items to be sifted in */
+    size_t buffered;
+    /* buffered items that cause a flush; 0 if offers aren't buffered */
+    size_t buffer_max;
+    /* the buffered item with the top priority */
+    void *buffer_top;
+    /* share of count that dead may reach before the heap is compacted */
+    double tombstone_ratio;
     /**  user data */
     const void *udata;
     int (*cmp) (const void *, const void *, const void *);
+    /* offset of the size_t inside each item that holds its index */
+    size_t idx_offset;
+    /* non-zero if items track their own index */
+    int track_idx;
+    /* log2 of the number of children each node has */
+    unsigned int arity_log2;
+    /* log2 of the block size for the blocked layout; 0 for the standard
+     * implicit layout */
+    unsigned int block_log2;
+    /* where the heap's memory comes from; NULL for malloc() */
+    const heap_allocator_t *alloc;
+    /* starts fetching the memory cmp reads from an item; may be NULL */
+    void (*prefetch) (const void *, const void *);
+#ifdef HEAP_STATS
+    heap_stats_t stats;
+#endif
     void * array[];
 };
 
-size_t heap_sizeof(unsigned int size)
+size_t heap_sizeof(size_t size)
 {
     return sizeof(heap_t) + size * sizeof(void *);
 }
 
-static int __child_left(const int idx)
+/**
+ * @return largest size whose heap_sizeof() doesn't overflow */
+static size_t __max_size(void)
+{
+    return (SIZE_MAX - sizeof(heap_t)) / sizeof(void *);
+}
+
+/*
+ * The blocked layout splits the array into aligned blocks of 2^L slots.
+ * Numbering slots from 1 within a block, slot p's children are 2p and
+ * 2p+1, as in an implicit heap. Block 0 holds the root at slot 1 and the
+ * top L levels. Every other block holds a pair of sibling subtrees rooted
+ * at slots 2 and 3, L-1 levels deep. Each node on a block's bottom level
+ * (slots 2^(L-1) to 2^L-1) has its two children at slots 2 and 3 of a
+ * block of its own, so a sift crosses into a new block only every L-1
+ * levels. Slots 0 and 1 of blocks other than block 0 are unused.
+ *
+ * Array indices are these positions minus one, which puts the root at
+ * index 0 like the implicit layout.
+ */
+
+/**
+ * @return index of the node's first child; siblings follow contiguously */
+static size_t __child_first(const heap_t * h, const size_t idx)
 {
-    return idx * 2 + 1;
+    size_t pos, p, half;
+
+    if (!h->block_log2)
+        return (idx << h->arity_log2) + 1;
+
+    pos = idx + 1;
+    half = (size_t)1 << (h->block_log2 - 1);
+    p = pos & (2 * half - 1);
+
+    if (p < half)
+        return pos + p - 1;
+
+    /* first child block of block b is b * half + 1 */
+    return ((((pos >> h->block_log2) * half + 1 + (p - half))
+             << h->block_log2) | 2) - 1;
 }
 
-static int __child_right(const int idx)
+static size_t __parent(const heap_t * h, const size_t idx)
 {
-    return idx * 2 + 2;
+    size_t pos, p, b, half;
+
+    if (!h->block_log2)
+        return (idx - 1) >> h->arity_log2;
+
+    pos = idx + 1;
+    half = (size_t)1 << (h->block_log2 - 1);
+    p = pos & (2 * half - 1);
+    b = pos >> h->block_log2;
+
+    if (4 <= p || 0 == b)
+        return pos - p + p / 2 - 1;
+
+    return ((((b - 1) / half) << h->block_log2) |
+            (half + (b - 1) % half)) - 1;
 }
 
-static int __parent(const int idx)
+/**
+ * Items fill the array in index order, which always puts a parent before
+ * its children.
+ *
+ * @return array index of the n-th item */
+static size_t __slot(const heap_t * h, const size_t n)
 {
-    return (idx - 1) / 2;
+    size_t first, per_block;
+
+    if (!h->block_log2)
+        return n;
+
+    /* block 0 has one more node than the others */
+    first = ((size_t)1 << h->block_log2) - 1;
+    if (n < first)
+        return n;
+
+    per_block = first - 1;
+    return ((1 + (n - first) / per_block) << h->block_log2) +
+        1 + (n - first) % per_block;
+}
+
+/**
+ * @return non-zero if idx can hold an item, ie. is not an unused slot */
+static int __is_slot(const heap_t * h, const size_t idx)
+{
+    size_t pos = idx + 1;
+
+    if (!h->block_log2)
+        return 1;
+
+    return (pos >> h->block_log2 ? 2 : 1) <=
+        (pos & (((size_t)1 << h->block_log2) - 1));
 }
 
 void heap_init(heap_t* h,
@@ -45,13 +189,89 @@ void heap_init(heap_t* h,
                            const void *,
                            const void *udata),
                const void *udata,
-               unsigned int size
+               size_t size
                )
 {
     h->cmp = cmp;
     h->udata = udata;
     h->size = size;
     h->count = 0;
+    h->dead = 0;
+    h->buffered = 0;
+    h->buffer_max = 0;
+    h->buffer_top = NULL;
+    h->tombstone_ratio = DEFAULT_TOMBSTONE_RATIO;
+    h->idx_offset = 0;
+    h->track_idx = 0;
+    h->arity_log2 = 1;
+    h->block_log2 = 0;
+    h->alloc = NULL;
+    h->prefetch = NULL;
+#ifdef HEAP_STATS
+    heap_reset_stats(h);
+#endif
+}
+
+int heap_set_arity(heap_t * h, unsigned int arity)
+{
+    unsigned int log2;
+
+    if (0 != h->count + h->buffered || arity < 2 || 0 != (arity & (arity - 1)))
+        return -1;
+
+    /* the blocked layout is binary */
+    if (h->block_log2 && 2 != arity)
+        return -1;
+
+    for (log2 = 0; (1u << log2) < arity; log2++)
+        ;
+    h->arity_log2 = log2;
+    return 0;
+}
+
+unsigned int heap_arity(const heap_t * h)
+{
+    return 1u << h->arity_log2;
+}
+
+int heap_set_block_size(heap_t * h, unsigned int block_size)
+{
+    unsigned int log2;
+
+    if (0 != h->count + h->buffered)
+        return -1;
+
+    /* the standard layout suits any arity */
+    if (0 == block_size)
+    {
+        h->block_log2 = 0;
+        return 0;
+    }
+
+    if (1 != h->arity_log2 || block_size < 4 || 0 != (block_size & (block_size - 1)))
+        return -1;
+
+    for (log2 = 0; (1u << log2) < block_size; log2++)
+        ;
+    h->block_log2 = log2;
+    return 0;
+}
+
+void heap_set_prefetch(heap_t * h,
+                       void (*prefetch) (const void *item,
+                                         const void *udata))
+{
+    h->prefetch = prefetch;
+}
+
+int heap_set_item_idx_offset(heap_t * h, size_t offset)
+{
+    if (0 != h->count + h->buffered)
+        return -1;
+
+    h->idx_offset = offset;
+    h->track_idx = 1;
+    return 0;
 }
 
 heap_t *heap_new(int (*cmp) (const void *,
@@ -59,87 +279,235 @@ heap_t *heap_new(int (*cmp) (const void *,
                              const void *udata),
                  const void *udata)
 {
-    heap_t *h = malloc(heap_sizeof(DEFAULT_CAPACITY));
+    return heap_new_ex(cmp, udata, NULL);
+}
+
+heap_t *heap_new_ex(int (*cmp) (const void *,
+                                const void *,
+                                const void *udata),
+                    const void *udata,
+                    const heap_allocator_t *alloc)
+{
+    size_t size = heap_sizeof(DEFAULT_CAPACITY);
+    heap_t *h = alloc ? alloc->malloc(size, alloc->ctx) : malloc(size);
 
     if (!h)
         return NULL;
 
     heap_init(h, cmp, udata, DEFAULT_CAPACITY);
+    h->alloc = alloc;
 
     return h;
 }
 
 void heap_free(heap_t * h)
 {
-    free(h);
+    if (h->alloc)
+        h->alloc->free(h, heap_sizeof(h->size), h->alloc->ctx);
+    else
+        free(h);
+}
+
+static heap_t* __resize(heap_t * h, size_t size)
+{
+    if (h->alloc)
+        return h->alloc->realloc(h, heap_sizeof(h->size), heap_sizeof(size),
+                                 h->alloc->ctx);
+
+    return realloc(h, heap_sizeof(size));
+}
+
+/**
+ * Make room for at least size items, growing the array at most once
+ *
+ * @return a new heap on success; NULL otherwise, leaving h untouched */
+static heap_t* __reserve(heap_t * h, size_t size)
+{
+    size_t new_size = h->size * 2;
+    heap_t *new_h;
+
+    if (size <= h->size)
+        return h;
+
+    if (__max_size() < size)
+        return NULL;
+
+    if (new_size < size || __max_size() < new_size)
+        new_size = size;
+
+    /* fall back to growing by just enough, eg. for a fixed reservation */
+    if (!(new_h = __resize(h, new_size)))
+    {
+        if (new_size == size || !(new_h = __resize(h, size)))
+            return NULL;
+        new_size = size;
+    }
+
+    new_h->size = new_size;
+    STAT_INC(new_h, grows);
+    return new_h;
 }
 
 /**
  * @return a new heap on success; NULL otherwise */
 static heap_t* __ensurecapacity(heap_t * h)
 {
-    if (h->count < h->size)
-        return h;
+    return __reserve(h, __slot(h, h->count + h->buffered) + 1);
+}
+
+static int __cmp(const heap_t * h, const void *a, const void *b)
+{
+    STAT_INC(h, comparisons);
+    return h->cmp(a, b, h->udata);
+}
+
+static size_t *__item_idx(const heap_t * h, const void *item)
+{
+    return (size_t *)((char *)item + h->idx_offset);
+}
 
-    h->size *= 2;
+/**
+ * Place item at idx, keeping the item's own index up to date. A cancelled
+ * item stays cancelled */
+static void __set(heap_t * h, const size_t idx, void *item)
+{
+    h->array[idx] = item;
+    if (h->track_idx)
+    {
+        size_t *item_idx = __item_idx(h, item);
 
-    return realloc(h, heap_sizeof(h->size));
+        *item_idx = (*item_idx & DEAD) | idx;
+    }
 }
 
-static void __swap(heap_t * h, const int i1, const int i2)
+/**
+ * Place an item that is new to the heap at idx */
+static void __set_live(heap_t * h, const size_t idx, void *item)
+{
+    h->array[idx] = item;
+    if (h->track_idx)
+        *__item_idx(h, item) = idx;
+}
+
+static int __is_dead(const heap_t * h, const void *item)
+{
+    return h->track_idx && (*__item_idx(h, item) & DEAD);
+}
+
+static void __swap(heap_t * h, const size_t i1, const size_t i2)
 {
     void *tmp = h->array[i1];
 
-    h->array[i1] = h->array[i2];
-    h->array[i2] = tmp;
+    STAT_INC(h, swaps);
+    __set(h, i1, h->array[i2]);
+    __set(h, i2, tmp);
 }
 
-static int __pushup(heap_t * h, unsigned int idx)
+/**
+ * Sifts down stall on a cache miss at every level, as the next children
+ * aren't known until the comparisons resolve. Start fetching ahead: the
+ * array slots two levels below the children starting at child, and, via
+ * the user's hook, the items one level below, whose slots were fetched
+ * at the previous level. Items are only prefetched for arities up to 4;
+ * wider nodes have too many grandchildren. Small heaps are left alone.
+ *
+ * @param[in] child First child of the node being sifted
+ * @param[in] end Index of the first slot not in use */
+static void __prefetch_below(const heap_t * h, size_t child, size_t end)
 {
+#ifndef HEAP_NO_PREFETCH
+    size_t last, c, g, gg;
+
+    if (end < HEAP_PREFETCH_MIN)
+        return;
+
+    g = __child_first(h, child);
+    if (g >= end)
+        return;
+
+    /* siblings' descendants follow on, so the first line is the best bet;
+     * past end there's nothing worth a possible TLB miss */
+    gg = __child_first(h, g);
+    if (gg < end)
+        PREFETCH(&h->array[gg]);
+
+    if (!h->prefetch || 2 < h->arity_log2)
+        return;
+
+    last = child + (1u << h->arity_log2);
+    if (last > end)
+        last = end;
+
+    for (c = child; c < last; c++)
+    {
+        g = __child_first(h, c);
+        for (gg = g; gg < g + (1u << h->arity_log2) && gg < end; gg++)
+            h->prefetch(h->array[gg], h->udata);
+    }
+#else
+    (void)h;
+    (void)child;
+    (void)end;
+#endif
+}
+
+/**
+ * @return the index the item ended up at */
+static size_t __pushup(heap_t * h, size_t idx)
+{
+    STAT_INC(h, sifts);
+
     /* 0 is the root node */
     while (0 != idx)
     {
-        int parent = __parent(idx);
+        size_t parent = __parent(h, idx);
 
         /* we are smaller than the parent */
-        if (h->cmp(h->array[idx], h->array[parent], h->udata) < 0)
-            return -1;
+        if (__cmp(h, h->array[idx], h->array[parent]) < 0)
+            return idx;
         else
             __swap(h, idx, parent);
 
+        STAT_INC(h, sift_levels);
         idx = parent;
     }
 
     return idx;
 }
 
-static void __pushdown(heap_t * h, unsigned int idx)
+static void __pushdown(heap_t * h, size_t idx)
 {
+    /* slots before this index are exactly the ones in use */
+    size_t end = __slot(h, h->count);
+
+    STAT_INC(h, sifts);
+
     while (1)
     {
-        unsigned int childl, childr, child;
+        size_t child, last, c;
 
-        childl = __child_left(idx);
-        childr = __child_right(idx);
+        child = __child_first(h, idx);
 
-        if (childr >= h->count)
-        {
-            /* can't pushdown any further */
-            if (childl >= h->count)
-                return;
+        /* can't pushdown any further */
+        if (child >= end)
+            return;
+
+        __prefetch_below(h, child, end);
+
+        last = child + (1u << h->arity_log2);
+        if (last > end)
+            last = end;
 
-            child = childl;
-        }
         /* find biggest child */
-        else if (h->cmp(h->array[childl], h->array[childr], h->udata) < 0)
-            child = childr;
-        else
-            child = childl;
+        for (c = child + 1; c < last; c++)
+            if (__cmp(h, h->array[child], h->array[c]) < 0)
+                child = c;
 
         /* idx is smaller than child */
-        if (h->cmp(h->array[idx], h->array[child], h->udata) < 0)
+        if (__cmp(h, h->array[idx], h->array[child]) < 0)
         {
             __swap(h, idx, child);
+            STAT_INC(h, sift_levels);
             idx = child;
             /* bigger than the biggest child, we stop, we win */
         }
@@ -148,17 +516,285 @@ static void __pushdown(heap_t * h, unsigned int idx)
     }
 }
 
+/**
+ * Restore the heap property for the item at idx, which may need to move
+ * either up or down */
+static void __resift(heap_t * h, size_t idx)
+{
+    if (__pushup(h, idx) == idx)
+        __pushdown(h, idx);
+}
+
+/**
+ * Floyd's bottom-up heapify of the whole array. O(n) */
+static void __heapify(heap_t * h)
+{
+    size_t idx;
+
+    if (h->count < 2)
+        return;
+
+    /* in the blocked layout nodes with children aren't a prefix of the
+     * array, so every node is visited */
+    if (h->block_log2)
+    {
+        for (idx = h->count; 0 < idx; idx--)
+            __pushdown(h, __slot(h, idx - 1));
+        return;
+    }
+
+    for (idx = __parent(h, h->count - 1) + 1; 0 < idx; idx--)
+        __pushdown(h, idx - 1);
+}
+
+/**
+ * Cancelled items are left in place until they reach the top. Remove them
+ * from there, so that the top item is always live */
+static void __drop_dead_top(heap_t * h)
+{
+    while (0 < h->dead && __is_dead(h, h->array[0]))
+    {
+        *__item_idx(h, h->array[0]) &= ~DEAD;
+        h->dead--;
+        h->count--;
+        if (0 < h->count)
+        {
+            __set(h, 0, h->array[__slot(h, h->count)]);
+            __pushdown(h, 0);
+        }
+    }
+}
+
+/**
+ * Squeeze the cancelled items out of the array and heapify what's left.
+ * O(n) */
+static void __compact(heap_t * h)
+{
+    size_t n, live = 0;
+
+    for (n = 0; n < h->count; n++)
+    {
+        void *item = h->array[__slot(h, n)];
+
+        if (__is_dead(h, item))
+            *__item_idx(h, item) &= ~DEAD;
+        else
+            __set(h, __slot(h, live++), item);
+    }
+
+    h->count = live;
+    h->dead = 0;
+    __heapify(h);
+    STAT_INC(h, compactions);
+}
+
+static unsigned int __log2(size_t n)
+{
+    unsigned int log2 = 0;
+
+    while (n >>= 1)
+        log2++;
+    return log2;
+}
+
+/**
+ * Sift the buffered items into the heap. The new items follow on from the
+ * old, so Floyd's heapify need only visit them and their ancestors, which
+ * shrink to a single path within a few levels: O(b + log n log b) for b
+ * items, however their priorities compare. In the blocked layout items
+ * and their parents aren't contiguous; a few items are sifted up one by
+ * one there, more with a full heapify. */
+static void __flush(heap_t * h)
+{
+    size_t lo = h->count, hi = h->count + h->buffered - 1, idx;
+
+    /* dropping dead tops while items are buffered would move the last
+     * heap item, not the last buffered one, so it waits until here */
+    if (0 == h->buffered)
+    {
+        __drop_dead_top(h);
+        return;
+    }
+
+    h->count += h->buffered;
+    h->buffered = 0;
+
+    if (h->block_log2)
+    {
+        if (h->count <= (hi + 1 - lo) * __log2(h->count))
+            __heapify(h);
+        else
+            for (idx = lo; idx <= hi; idx++)
+                __pushup(h, __slot(h, idx));
+        __drop_dead_top(h);
+        return;
+    }
+
+    /* visit deepest first, so that both subtrees of each node are heaps
+     * by the time it is pushed down */
+    while (1)
+    {
+        for (idx = hi + 1; lo < idx; idx--)
+            __pushdown(h, idx - 1);
+
+        if (0 == lo)
+            break;
+
+        /* parents from lo up have just been visited */
+        hi = __parent(h, hi);
+        if (lo <= hi)
+            hi = lo - 1;
+        lo = __parent(h, lo);
+    }
+
+    __drop_dead_top(h);
+}
+
+/**
+ * Find item's index on the heap's array
+ *
+ * @param[out] idx Receives the index
+ * @return 0 on success; -1 if item does not exist */
+static int __item_get_idx(const heap_t * h, const void *item, size_t *idx)
+{
+    size_t ii, end = __slot(h, h->count + h->buffered);
+
+    if (h->track_idx)
+    {
+        if (NULL == item)
+            return -1;
+        /* cancelled items have DEAD set, which puts them out of range */
+        ii = *__item_idx(h, item);
+        if (ii < end && __is_slot(h, ii) && h->array[ii] == item)
+        {
+            *idx = ii;
+            return 0;
+        }
+        return -1;
+    }
+
+    for (ii = 0; ii < end; ii++)
+        if (__is_slot(h, ii) && 0 == __cmp(h, h->array[ii], item))
+        {
+            *idx = ii;
+            return 0;
+        }
+
+    return -1;
+}
+
+/**
+ * Restore the heap after the items at the m indices in at[] changed.
+ *
+ * Sifting the items one after another isn't enough, as each sift trusts
+ * the others' positions. Instead run Floyd's heapify over just the changed
+ * nodes and their ancestors, deepest first, so that both subtrees of each
+ * node are heaps by the time it is pushed down. at[] holds one cursor per
+ * item, climbing towards the root, and is used up. */
+static void __resift_many(heap_t * h, size_t *at, size_t m)
+{
+    size_t ii;
+
+    while (0 < m)
+    {
+        size_t idx, hi = 0;
+
+        for (ii = 1; ii < m; ii++)
+            if (at[hi] < at[ii])
+                hi = ii;
+
+        idx = at[hi];
+        __pushdown(h, idx);
+
+        for (ii = 0; ii < m;)
+            if (at[ii] != idx)
+                ii++;
+            else if (0 == idx)
+                at[ii] = at[--m];
+            else
+                at[ii++] = __parent(h, idx);
+    }
+}
+
+/**
+ * Find a cancelled item that hasn't been dropped from the array yet
+ *
+ * @param[out] idx Receives the item's index
+ * @return 1 if item is such an item; otherwise 0 */
+static int __is_tombstone(const heap_t * h, const void *item, size_t *idx)
+{
+    size_t ii;
+
+    if (!h->track_idx || 0 == h->dead)
+        return 0;
+
+    ii = *__item_idx(h, item);
+    if (!(ii & DEAD))
+        return 0;
+
+    ii &= ~DEAD;
+    if (ii >= __slot(h, h->count) || !__is_slot(h, ii) ||
+        h->array[ii] != item)
+        return 0;
+
+    *idx = ii;
+    return 1;
+}
+
+/**
+ * Offering a cancelled item that is still in the array brings it back
+ * where it is, instead of adding it twice. Its priority may have changed
+ * since it was cancelled, as long as no other item's has since.
+ *
+ * @return 1 if item was revived; otherwise 0 */
+static int __revive(heap_t * h, void *item)
+{
+    size_t idx;
+
+    if (!__is_tombstone(h, item, &idx))
+        return 0;
+
+    h->dead--;
+    __set_live(h, idx, item);
+    __resift(h, idx);
+    STAT_INC(h, offers);
+    return 1;
+}
+
 static void __heap_offerx(heap_t * h, void *item)
 {
-    h->array[h->count] = item;
+    size_t idx;
+
+    if (__revive(h, item))
+        return;
+
+    if (h->buffer_max)
+    {
+        /* append without sifting, only keeping track of the top item */
+        __set_live(h, __slot(h, h->count + h->buffered), item);
+        if (0 == h->buffered++ || __cmp(h, h->buffer_top, item) < 0)
+            h->buffer_top = item;
+        STAT_INC(h, offers);
+        STAT_HIGH_WATER(h);
+        if (h->buffered >= h->buffer_max)
+            __flush(h);
+        return;
+    }
+
+    idx = __slot(h, h->count++);
+    __set_live(h, idx, item);
 
     /* ensure heap properties */
-    __pushup(h, h->count++);
+    __pushup(h, idx);
+    STAT_INC(h, offers);
+    STAT_HIGH_WATER(h);
 }
 
 int heap_offerx(heap_t * h, void *item)
 {
-    if (h->count == h->size)
+    if (__revive(h, item))
+        return 0;
+    if (__slot(h, h->count + h->buffered) >= h->size)
         return -1;
     __heap_offerx(h, item);
     return 0;
@@ -166,86 +802,580 @@ int heap_offerx(heap_t * h, void *item)
 
 int heap_offer(heap_t ** h, void *item)
 {
-    if (NULL == (*h = __ensurecapacity(*h)))
+    heap_t *new_h = __ensurecapacity(*h);
+
+    if (!new_h)
         return -1;
 
+    *h = new_h;
     __heap_offerx(*h, item);
     return 0;
 }
 
+int heap_offer_many(heap_t ** hp, void **items, size_t n)
+{
+    size_t at[UPDATE_MANY_SIFTS], ii, idx, total, revived = 0;
+    heap_t *h;
+
+    if (0 == n)
+        return 0;
+
+    __flush(*hp);
+    if (__max_size() - (*hp)->count < n ||
+        NULL == (h = __reserve(*hp, __slot(*hp, (*hp)->count + n - 1) + 1)))
+        return -1;
+    *hp = h;
+
+    /* bring back cancelled items before sifting anything else, as they
+     * may have been given new priorities */
+    for (ii = 0; ii < n; ii++)
+        if (__is_tombstone(h, items[ii], &idx))
+        {
+            h->dead--;
+            __set_live(h, idx, items[ii]);
+            if (revived < UPDATE_MANY_SIFTS)
+                at[revived] = idx;
+            revived++;
+            STAT_INC(h, offers);
+        }
+
+    total = h->count + n - revived;
+
+    /* a few items into a big heap are cheaper to sift up one by one */
+    if (revived <= UPDATE_MANY_SIFTS &&
+        (n - revived) * __log2(total) < total)
+    {
+        __resift_many(h, at, revived);
+        __drop_dead_top(h);
+        for (ii = 0; ii < n; ii++)
+            if (!revived || -1 == __item_get_idx(h, items[ii], &idx))
+                __heap_offerx(h, items[ii]);
+        return 0;
+    }
+
+    for (ii = 0; ii < n; ii++)
+    {
+        /* revived items are already in place */
+        if (revived && 0 == __item_get_idx(h, items[ii], &idx))
+            continue;
+        __set_live(h, __slot(h, h->count), items[ii]);
+        h->count++;
+        STAT_INC(h, offers);
+    }
+    __heapify(h);
+    __drop_dead_top(h);
+    STAT_HIGH_WATER(h);
+    return 0;
+}
+
+heap_t *heap_new_bounded(int (*cmp) (const void *,
+                                     const void *,
+                                     const void *udata),
+                         const void *udata,
+                         size_t k)
+{
+    heap_t *h;
+
+    if (0 == k || __max_size() < k || !(h = malloc(heap_sizeof(k))))
+        return NULL;
+
+    heap_init(h, cmp, udata, k);
+    return h;
+}
+
+heap_t *heap_new_from_array(int (*cmp) (const void *,
+                                        const void *,
+                                        const void *udata),
+                            const void *udata,
+                            void **items,
+                            size_t n)
+{
+    size_t size = n < DEFAULT_CAPACITY ? DEFAULT_CAPACITY : n;
+    heap_t *h;
+
+    if (__max_size() < size || !(h = malloc(heap_sizeof(size))))
+        return NULL;
+
+    heap_init(h, cmp, udata, size);
+    memcpy(h->array, items, n * sizeof(void *));
+    h->count = n;
+    __heapify(h);
+    STAT_ADD(h, offers, n);
+    STAT_HIGH_WATER(h);
+
+    return h;
+}
+
 void *heap_poll(heap_t * h)
 {
+    __flush(h);
+
     if (0 == heap_count(h))
         return NULL;
 
     void *item = h->array[0];
 
-    h->array[0] = h->array[h->count - 1];
+    STAT_INC(h, polls);
     h->count--;
+    if (0 < h->count)
+        __set(h, 0, h->array[__slot(h, h->count)]);
 
     if (h->count > 1)
         __pushdown(h, 0);
 
+    __drop_dead_top(h);
     return item;
 }
 
-void *heap_peek(const heap_t * h)
+/**
+ * Sift the item at idx down using the bottom-up strategy: descend all the
+ * way to a leaf promoting the best child at each level, then sift the item
+ * back up from there. As the item usually belongs near the bottom this
+ * costs about half the comparisons of __pushdown. */
+static void __pushdown_bottomup(heap_t * h, size_t idx)
 {
-    if (0 == heap_count(h))
+    size_t end = __slot(h, h->count);
+    void *item = h->array[idx];
+
+    STAT_INC(h, sifts);
+
+    while (1)
+    {
+        size_t child, last, c;
+
+        child = __child_first(h, idx);
+
+        if (child >= end)
+            break;
+
+        __prefetch_below(h, child, end);
+
+        last = child + (1u << h->arity_log2);
+        if (last > end)
+            last = end;
+
+        /* find biggest child */
+        for (c = child + 1; c < last; c++)
+            if (__cmp(h, h->array[child], h->array[c]) < 0)
+                child = c;
+
+        __set(h, idx, h->array[child]);
+        STAT_INC(h, swaps);
+        STAT_INC(h, sift_levels);
+        idx = child;
+    }
+
+    __set(h, idx, item);
+    __pushup(h, idx);
+}
+
+static void *__poll_bottomup(heap_t * h)
+{
+    void *item = h->array[0];
+
+    STAT_INC(h, polls);
+    h->count--;
+    if (0 < h->count)
+    {
+        __set(h, 0, h->array[__slot(h, h->count)]);
+        __pushdown_bottomup(h, 0);
+        __drop_dead_top(h);
+    }
+
+    return item;
+}
+
+size_t heap_poll_n(heap_t * h, void **out, size_t n)
+{
+    size_t ii;
+
+    __flush(h);
+
+    for (ii = 0; ii < n && 0 < h->count; ii++)
+        out[ii] = __poll_bottomup(h);
+
+    return ii;
+}
+
+size_t heap_poll_until(heap_t * h, void **out, size_t max,
+                       const void *bound_item)
+{
+    size_t ii;
+
+    __flush(h);
+
+    for (ii = 0; ii < max && 0 < h->count; ii++)
+    {
+        if (__cmp(h, h->array[0], bound_item) < 0)
+            break;
+        out[ii] = __poll_bottomup(h);
+    }
+
+    return ii;
+}
+
+void *heap_pushpop(heap_t * h, void *item)
+{
+    void *top;
+
+    __flush(h);
+
+    /* a cancelled item is still in the array; offer it as usual */
+    if (__revive(h, item))
+        return heap_poll(h);
+
+    /* item would be polled straight back out */
+    if (0 == h->count || 0 <= __cmp(h, item, h->array[0]))
+        return item;
+
+    top = h->array[0];
+    STAT_INC(h, offers);
+    STAT_INC(h, polls);
+    __set_live(h, 0, item);
+    __pushdown_bottomup(h, 0);
+    __drop_dead_top(h);
+    return top;
+}
+
+void *heap_replace(heap_t * h, void *item)
+{
+    void *top;
+
+    __flush(h);
+
+    if (0 == h->count)
         return NULL;
 
-    return h->array[0];
+    /* a cancelled item is still in the array, perhaps re-keyed, so put it
+     * back in order before polling past it. If that makes it the top take
+     * it out again, as the top we return must be some other item */
+    if (__revive(h, item))
+    {
+        if (h->array[0] != item)
+            return heap_poll(h);
+        heap_poll(h);
+    }
+
+    top = h->array[0];
+    STAT_INC(h, offers);
+    STAT_INC(h, polls);
+    __set_live(h, 0, item);
+    __pushdown_bottomup(h, 0);
+    __drop_dead_top(h);
+    return top;
 }
 
-void heap_clear(heap_t * h)
+void *heap_offer_bounded(heap_t * h, void *item)
 {
-    h->count = 0;
+    __flush(h);
+
+    /* make room by dropping cancelled items before evicting live ones */
+    if (__slot(h, h->count) >= h->size && 0 < h->dead)
+        __compact(h);
+
+    if (__slot(h, h->count) < h->size)
+    {
+        __heap_offerx(h, item);
+        return NULL;
+    }
+
+    return heap_pushpop(h, item);
 }
 
-/**
- * @return item's index on the heap's array; otherwise -1 */
-static int __item_get_idx(const heap_t * h, const void *item)
+void *heap_peek(const heap_t * h)
 {
-    unsigned int idx;
+    if (0 == heap_count(h))
+        return NULL;
 
-    for (idx = 0; idx < h->count; idx++)
-        if (0 == h->cmp(h->array[idx], item, h->udata))
-            return idx;
+    /* the top is either the heap's or the best of the buffer */
+    if (0 < h->buffered &&
+        (0 == h->count || __cmp(h, h->array[0], h->buffer_top) < 0))
+        return h->buffer_top;
 
-    return -1;
+    return h->array[0];
+}
+
+void heap_clear(heap_t * h)
+{
+    h->count = 0;
+    h->dead = 0;
+    h->buffered = 0;
 }
 
 void *heap_remove_item(heap_t * h, const void *item)
 {
-    int idx = __item_get_idx(h, item);
+    size_t idx, last;
 
-    if (idx == -1)
+    __flush(h);
+
+    if (-1 == __item_get_idx(h, item, &idx))
         return NULL;
 
     /* swap the item we found with the last item on the heap */
     void *ret_item = h->array[idx];
-    h->array[idx] = h->array[h->count - 1];
-    h->array[h->count - 1] = NULL;
 
+    STAT_INC(h, removes);
     h->count -= 1;
+    last = __slot(h, h->count);
 
-    /* ensure heap property */
-    __pushup(h, idx);
+    if (idx != last)
+    {
+        __set(h, idx, h->array[last]);
+
+        /* ensure heap property */
+        __resift(h, idx);
+    }
+
+    h->array[last] = NULL;
+    __drop_dead_top(h);
 
     return ret_item;
 }
 
+int heap_update_item(heap_t * h, const void *item)
+{
+    size_t idx;
+
+    if (-1 == __item_get_idx(h, item, &idx))
+        return -1;
+
+    /* fix the item's place before sifting anything else in, as those
+     * sifts rely on the heap being in order; buffered items have none */
+    if (idx < __slot(h, h->count))
+        __resift(h, idx);
+    __flush(h);
+    return 0;
+}
+
+int heap_cancel(heap_t * h, const void *item)
+{
+    size_t idx;
+
+    __flush(h);
+
+    if (!h->track_idx || -1 == __item_get_idx(h, item, &idx))
+        return -1;
+
+    STAT_INC(h, cancels);
+
+    /* the top and last items are as cheap to remove outright */
+    if (0 == idx || __slot(h, h->count - 1) == idx)
+    {
+        heap_remove_item(h, item);
+        return 0;
+    }
+
+    *__item_idx(h, item) |= DEAD;
+    h->dead++;
+
+    if (h->dead > h->tombstone_ratio * h->count)
+        __compact(h);
+
+    return 0;
+}
+
+void heap_set_offer_buffer(heap_t * h, size_t max_items)
+{
+    h->buffer_max = max_items;
+    if (h->buffered >= max_items)
+        __flush(h);
+}
+
+void heap_compact(heap_t * h)
+{
+    __flush(h);
+
+    if (0 < h->dead)
+        __compact(h);
+}
+
+int heap_set_tombstone_ratio(heap_t * h, double ratio)
+{
+    if (!(0 < ratio && ratio <= 1))
+        return -1;
+
+    h->tombstone_ratio = ratio;
+    return 0;
+}
+
 int heap_contains_item(const heap_t * h, const void *item)
 {
-    return __item_get_idx(h, item) != -1;
+    size_t idx;
+
+    return __item_get_idx(h, item, &idx) != -1;
+}
+
+size_t heap_remove_if(heap_t * h,
+                      int (*pred) (const void *item, const void *udata),
+                      const void *udata,
+                      void (*removed) (void *item, const void *udata))
+{
+    size_t n = 0, k = 0, live;
+    size_t limit;
+
+    __flush(h);
+
+    /* an item moved into a hole from the end usually stays near the
+     * bottom, so removals in place cost a few comparisons each, against
+     * about two per item for a rebuild */
+    limit = h->count / 2;
+
+    while (n < h->count && k < limit)
+    {
+        size_t idx = __slot(h, n);
+        void *item = h->array[idx], *tail;
+
+        if (__is_dead(h, item) || !pred(item, udata))
+        {
+            n++;
+            continue;
+        }
+
+        if (removed)
+            removed(item, udata);
+        k++;
+        h->count--;
+
+        /* fill the hole from the end, testing what we take from there
+         * first, so that it isn't skipped */
+        while (n < h->count)
+        {
+            tail = h->array[__slot(h, h->count)];
+            if (__is_dead(h, tail) || !pred(tail, udata))
+                break;
+            if (removed)
+                removed(tail, udata);
+            k++;
+            h->count--;
+        }
+
+        if (n == h->count)
+            break;
+
+        tail = h->array[__slot(h, h->count)];
+        __set(h, idx, tail);
+
+        /* idx now holds either a tested item, or, if tail sank, one of
+         * its untested children */
+        if (__pushup(h, idx) != idx)
+            n++;
+        else
+        {
+            __pushdown(h, idx);
+            if (h->array[idx] == tail)
+                n++;
+        }
+    }
+
+    /* too many to remove one by one: squeeze the survivors of the rest of
+     * the array together, dropping cancelled items too, and rebuild */
+    if (n < h->count)
+    {
+        for (live = n; n < h->count; n++)
+        {
+            void *item = h->array[__slot(h, n)];
+
+            if (__is_dead(h, item))
+            {
+                *__item_idx(h, item) &= ~DEAD;
+                h->dead--;
+            }
+            else if (pred(item, udata))
+            {
+                if (removed)
+                    removed(item, udata);
+                k++;
+            }
+            else
+                __set(h, __slot(h, live++), item);
+        }
+
+        h->count = live;
+        __heapify(h);
+    }
+
+    __drop_dead_top(h);
+    STAT_ADD(h, removes, k);
+    return k;
+}
+
+void heap_reprioritise_all(heap_t * h,
+                           void (*reprioritise) (void *item,
+                                                 const void *udata),
+                           const void *udata)
+{
+    size_t n, live = 0;
+
+    __flush(h);
+
+    /* the heap is rebuilt anyway, so cancelled items go for free */
+    for (n = 0; n < h->count; n++)
+    {
+        void *item = h->array[__slot(h, n)];
+
+        if (__is_dead(h, item))
+        {
+            *__item_idx(h, item) &= ~DEAD;
+            continue;
+        }
+
+        if (reprioritise)
+            reprioritise(item, udata);
+        __set(h, __slot(h, live++), item);
+    }
+
+    h->count = live;
+    h->dead = 0;
+    __heapify(h);
+}
+
+void heap_update_many(heap_t * h, void **items, size_t n)
+{
+    size_t at[UPDATE_MANY_SIFTS], ii, m = 0;
+
+    /* without tracking each item costs a scan to find, so always rebuild */
+    if (!h->track_idx || UPDATE_MANY_SIFTS < n ||
+        n * (__log2(h->count) + 1) >= h->count)
+    {
+        heap_reprioritise_all(h, NULL, NULL);
+        return;
+    }
+
+    /* buffered items are sifted in afterwards anyway */
+    for (ii = 0; ii < n; ii++)
+        if (0 == __item_get_idx(h, items[ii], &at[m]) &&
+            at[m] < __slot(h, h->count))
+            m++;
+
+    __resift_many(h, at, m);
+
+    __flush(h);
+}
+
+#ifdef HEAP_STATS
+void heap_get_stats(const heap_t * h, heap_stats_t * stats)
+{
+    *stats = h->stats;
+}
+
+void heap_reset_stats(heap_t * h)
+{
+    memset(&h->stats, 0, sizeof(h->stats));
+    h->stats.high_water = h->count + h->buffered;
+}
+#endif
+
+size_t heap_count(const heap_t * h)
+{
+    return h->count + h->buffered - h->dead;
 }
 
-int heap_count(const heap_t * h)
+size_t heap_count_dead(const heap_t * h)
 {
-    return h->count;
+    return h->dead;
 }
 
-int heap_size(const heap_t * h)
+size_t heap_size(const heap_t * h)
 {
     return h->size;
 }
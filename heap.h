@@ -1,8 +1,52 @@
 #ifndef HEAP_H
 #define HEAP_H
 
+#include <stddef.h>
+
 typedef struct heap_s heap_t;
 
+/**
+ * Memory callbacks used in place of malloc(), realloc() and free().
+ *
+ * Sizes are in bytes. realloc and free are given the block's current size
+ * so that arenas and pools don't have to track it. */
+typedef struct
+{
+    void *(*malloc) (size_t size, void *ctx);
+    void *(*realloc) (void *ptr, size_t old_size, size_t new_size, void *ctx);
+    void (*free) (void *ptr, size_t size, void *ctx);
+    /* passed through to the callbacks */
+    void *ctx;
+} heap_allocator_t;
+
+#ifdef HEAP_STATS
+/**
+ * Operation counters. Only available when compiled with -DHEAP_STATS;
+ * otherwise they are compiled out entirely. */
+typedef struct
+{
+    unsigned long offers;
+    unsigned long polls;
+    unsigned long removes;
+    /* calls to cmp */
+    unsigned long comparisons;
+    /* items moved by a sift */
+    unsigned long swaps;
+    /* times the array was enlarged */
+    unsigned long grows;
+    /* largest number of items held at once */
+    unsigned long high_water;
+    /* sift operations; average sift depth is sift_levels / sifts */
+    unsigned long sifts;
+    /* levels moved by all sifts */
+    unsigned long sift_levels;
+    /* calls to heap_cancel() that found the item */
+    unsigned long cancels;
+    /* times cancelled items were squeezed out of the array */
+    unsigned long compactions;
+} heap_stats_t;
+#endif
+
 /**
  * Create new heap and initialise it.
  *
@@ -16,6 +60,22 @@ heap_t *heap_new(int (*cmp) (const void *,
                              const void *udata),
                  const void *udata);
 
+/**
+ * Create new heap and initialise it.
+ *
+ * All of the heap's memory, including growth in heap_offer(), comes from
+ * alloc. The allocator must outlive the heap.
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @param[in] alloc Memory callbacks; NULL to use malloc()
+ * @return initialised heap */
+heap_t *heap_new_ex(int (*cmp) (const void *,
+                                const void *,
+                                const void *udata),
+                    const void *udata,
+                    const heap_allocator_t *alloc);
+
 /**
  * Initialise heap. Use memory passed by user.
  *
@@ -29,10 +89,130 @@ void heap_init(heap_t* h,
                            const void *,
                            const void *udata),
                const void *udata,
-               unsigned int size);
+               size_t size);
+
+/**
+ * Create new heap holding the given items.
+ *
+ * The heap is built bottom-up in O(n) rather than by n heap_offer()s.
+ * To have items track their index use heap_offer_many() on a new heap.
+ *
+ * malloc()s space for heap.
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @param[in] items Array of items to add; copied into the heap
+ * @param[in] n Number of items in the array
+ * @return initialised heap */
+heap_t *heap_new_from_array(int (*cmp) (const void *,
+                                        const void *,
+                                        const void *udata),
+                            const void *udata,
+                            void **items,
+                            size_t n);
+
+/**
+ * Create new heap with a fixed capacity, for use with heap_offer_bounded().
+ *
+ * malloc()s space for heap.
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @param[in] k Most items the heap holds
+ * @return initialised heap; NULL on failure */
+heap_t *heap_new_bounded(int (*cmp) (const void *,
+                                     const void *,
+                                     const void *udata),
+                         const void *udata,
+                         size_t k);
 
 void heap_free(heap_t * hp);
 
+/**
+ * Set a hook that starts fetching the memory cmp reads from an item.
+ *
+ * Sifts down already prefetch the heap's own array two levels ahead. When
+ * cmp dereferences items, eg. to read a key behind a pointer, each level
+ * still waits on those loads; the hook lets the heap issue them a level
+ * early. A typical hook is __builtin_prefetch(item) or a prefetch of the
+ * key the item points to. It must not fault or modify the item.
+ *
+ * Only used for arities up to 4. Heaps of fewer than 16384 slots likely
+ * stay in cache, so they are not prefetched at all; build heap.c with
+ * -DHEAP_PREFETCH_MIN=<slots> to move that cutoff. Compile with
+ * -DHEAP_NO_PREFETCH to disable all prefetching.
+ *
+ * @param[in] prefetch Hook given an item and the heap's udata; NULL to
+ *  remove it */
+void heap_set_prefetch(heap_t * hp,
+                       void (*prefetch) (const void *item,
+                                         const void *udata));
+
+/**
+ * Have items track their own position within the heap.
+ *
+ * Each item must have a size_t at the given offset (eg. obtained
+ * with offsetof()). The heap keeps this field up to date, which lets
+ * heap_remove_item(), heap_contains_item() and heap_update_item() find the
+ * item in O(1) by pointer identity instead of a linear scan using cmp.
+ *
+ * NULL items can't be offered to a heap in this mode.
+ *
+ * @param[in] offset Byte offset of the index field within each item
+ * @return 0 on success; -1 if the heap is not empty */
+int heap_set_item_idx_offset(heap_t * hp, size_t offset);
+
+/**
+ * Buffer offered items instead of sifting each one up straight away.
+ *
+ * Buffered items are appended to the array unsorted, keeping track of the
+ * best of them, so an offer costs one comparison. The buffer is merged
+ * once it holds max_items, or before anything other than an offer, peek,
+ * count or membership test, by heapifying just the new items and their
+ * ancestors: O(b + log n log b) for b items. The heap behaves as if every
+ * offer had been sifted in.
+ *
+ * This suits bursts of offers between polls whose items would rise far,
+ * eg. priorities ahead of most of the heap. Items of random priority only
+ * rise a level or two, so sifting them up straight away is as cheap.
+ *
+ * @param[in] max_items Most items to buffer; 0 to stop buffering, which
+ *  sifts in any buffered items */
+void heap_set_offer_buffer(heap_t * hp, size_t max_items);
+
+/**
+ * Set the number of children each node has. Defaults to 2.
+ *
+ * Wider nodes make the tree shallower and keep all of a node's children
+ * within one or two cache lines, which helps heap_poll() on large heaps.
+ *
+ * @param[in] arity Number of children per node; a power of two >= 2
+ * @return 0 on success; -1 if arity is invalid or the heap is not empty */
+int heap_set_arity(heap_t * hp, unsigned int arity);
+
+/**
+ * @return number of children each node has */
+unsigned int heap_arity(const heap_t * hp);
+
+/**
+ * Lay the array out in blocks of block_size slots (a B-heap).
+ *
+ * In the standard layout each level of a sift on a large heap touches a
+ * different page. The blocked layout packs subtrees several levels deep
+ * into each block, so a sift moves to a new block only every
+ * log2(block_size) - 1 levels. 8 slots suit 64 byte cache lines; 512 suit
+ * 4KB pages, and cut page faults and TLB misses once the heap outgrows
+ * the TLB or memory.
+ *
+ * Two slots in every block are left unused, so heap_size() counts array
+ * slots rather than items. Only binary heaps can be blocked.
+ *
+ * @param[in] block_size Slots per block; a power of two >= 4, or 0 for the
+ *  standard layout
+ * @return 0 on success; -1 if block_size is invalid, the heap is not empty
+ *  or block_size isn't 0 and the arity isn't 2 */
+int heap_set_block_size(heap_t * hp, unsigned int block_size);
+
 /**
  * Add item
  *
@@ -44,9 +224,25 @@ void heap_free(heap_t * hp);
  *
  * @param[in/out] hp_ptr Pointer to the heap. Changed when heap is enlarged.
  * @param[in] item The item to be added
- * @return 0 on success; -1 on failure */
+ * @return 0 on success; -1 on failure, in which case the heap is unchanged */
 int heap_offer(heap_t **hp_ptr, void *item);
 
+/**
+ * Add many items
+ *
+ * The array is enlarged at most once. Large batches are merged with an O(n)
+ * bottom-up heapify; small batches are sifted up individually.
+ *
+ * NOTE:
+ *  realloc() possibly called.
+ *  The heap pointer will be changed if the heap needs to be enlarged.
+ *
+ * @param[in/out] hp_ptr Pointer to the heap. Changed when heap is enlarged.
+ * @param[in] items Array of items to add
+ * @param[in] n Number of items in the array
+ * @return 0 on success; -1 on failure, in which case the heap is unchanged */
+int heap_offer_many(heap_t **hp_ptr, void **items, size_t n);
+
 /**
  * Add item
  *
@@ -65,6 +261,69 @@ int heap_offerx(heap_t * hp, void *item);
  * @return top item */
 void *heap_poll(heap_t * hp);
 
+/**
+ * Add item, then remove the item with the top priority
+ *
+ * Cheaper than heap_offer() followed by heap_poll(). When item would be
+ * the top it is returned after a single comparison without touching the
+ * heap. Never enlarges the heap.
+ *
+ * @param[in] item The item to be added
+ * @return top item out of the heap and item */
+void *heap_pushpop(heap_t * hp, void *item);
+
+/**
+ * Remove the item with the top priority, then add item
+ *
+ * Cheaper than heap_poll() followed by heap_offer(). Unlike
+ * heap_pushpop() the returned item is always from the heap, even if item
+ * has a higher priority.
+ *
+ * @param[in] item The item to be added
+ * @return top item; NULL if the heap is empty, in which case item is not
+ *  added */
+void *heap_replace(heap_t * hp, void *item);
+
+/**
+ * Add item to a heap of fixed capacity, evicting the top item if full
+ *
+ * For keeping the best K of a stream, order the heap so that the worst of
+ * the kept items is at the top (eg. lowest score first); once the heap
+ * is full it holds the K items that would be polled last. An item that
+ * can't get in is rejected with one comparison.
+ *
+ * NOTE:
+ *  no malloc()s called. See heap_new_bounded().
+ *
+ * @param[in] item The item to be added
+ * @return NULL if item was added to a heap with room; otherwise the item
+ *  that didn't fit, which is either the evicted top item or item itself */
+void *heap_offer_bounded(heap_t * hp, void *item);
+
+/**
+ * Remove up to n items with the top priority
+ *
+ * Cheaper than calling heap_poll() n times.
+ *
+ * @param[out] out Array that receives the items in priority order
+ * @param[in] n Maximum number of items to remove
+ * @return number of items removed */
+size_t heap_poll_n(heap_t * hp, void **out, size_t n);
+
+/**
+ * Remove items while the top item does not have a lower priority than
+ * bound_item (ie. cmp(top, bound_item) >= 0)
+ *
+ * Typical use is draining all expired timers: bound_item is a timer set to
+ * the current time.
+ *
+ * @param[out] out Array that receives the items in priority order
+ * @param[in] max Maximum number of items to remove
+ * @param[in] bound_item Item that removed items are compared against
+ * @return number of items removed */
+size_t heap_poll_until(heap_t * hp, void **out, size_t max,
+                       const void *bound_item);
+
 /**
  * @return top item of the heap */
 void *heap_peek(const heap_t * hp);
@@ -78,20 +337,28 @@ void *heap_peek(const heap_t * hp);
 void heap_clear(heap_t * hp);
 
 /**
- * @return number of items in heap */
-int heap_count(const heap_t * hp);
+ * @return number of items in heap, not counting cancelled ones */
+size_t heap_count(const heap_t * hp);
+
+/**
+ * @return number of cancelled items still held in the heap's array; see
+ *  heap_cancel() */
+size_t heap_count_dead(const heap_t * hp);
 
 /**
- * @return size of array */
-int heap_size(const heap_t * hp);
+ * @return size of array; see heap_set_block_size() */
+size_t heap_size(const heap_t * hp);
 
 /**
  * @return number of bytes needed for a heap of this size. */
-size_t heap_sizeof(unsigned int size);
+size_t heap_sizeof(size_t size);
 
 /**
  * Remove item
  *
+ * When items track their own index the item is matched by pointer;
+ * otherwise the first item that cmp reports as equal is removed.
+ *
  * @param[in] item The item that is to be removed
  * @return item to be removed; NULL if item does not exist */
 void *heap_remove_item(heap_t * hp, const void *item);
@@ -103,4 +370,117 @@ void *heap_remove_item(heap_t * hp, const void *item);
  * @return 1 if the heap contains this item; otherwise 0 */
 int heap_contains_item(const heap_t * hp, const void *item);
 
+/**
+ * Restore the item's position after its priority has changed
+ *
+ * The item is sifted up or down as needed. O(log n) when items track their
+ * own index; otherwise finding the item is O(n).
+ *
+ * @param[in] item The item whose priority changed
+ * @return 0 on success; -1 if item does not exist */
+int heap_update_item(heap_t * hp, const void *item);
+
+/**
+ * Remove every item that pred matches, in one pass over the heap
+ *
+ * Matches are removed one by one, as heap_remove_item() would; once half
+ * the items have gone the rest of the array is compacted and the heap
+ * rebuilt in O(n). Without index tracking this is far cheaper than a
+ * heap_remove_item() per item. Cancelled items aren't tested.
+ *
+ * pred must not modify the heap. It is called at least once for every
+ * item, and occasionally twice for an item it keeps.
+ *
+ * @param[in] pred Returns non-zero for items to remove
+ * @param[in] udata User data passed through to pred and removed
+ * @param[in] removed Called once with each removed item; may be NULL
+ * @return number of items removed */
+size_t heap_remove_if(heap_t * hp,
+                      int (*pred) (const void *item, const void *udata),
+                      const void *udata,
+                      void (*removed) (void *item, const void *udata));
+
+/**
+ * Change the priority of every item, then rebuild the heap in O(n)
+ *
+ * Use this when most priorities change at once, eg. after ageing every
+ * item, or after changing something in udata that cmp depends on.
+ * Cancelled items are removed along the way.
+ *
+ * @param[in] reprioritise Called once with each item; may be NULL if the
+ *  priorities have already changed
+ * @param[in] udata User data passed through to reprioritise */
+void heap_reprioritise_all(heap_t * hp,
+                           void (*reprioritise) (void *item,
+                                                 const void *udata),
+                           const void *udata);
+
+/**
+ * Restore the heap after the priorities of several items have changed
+ *
+ * When items track their index and there are only a few of them (up to
+ * 32), just they and their ancestors are sifted; otherwise the whole heap
+ * is rebuilt in O(n). Calling heap_update_item() for each item instead is
+ * only safe if it follows each change straight away. Items that aren't in
+ * the heap are ignored.
+ *
+ * @param[in] items Items whose priority changed
+ * @param[in] n Number of items in the array */
+void heap_update_many(heap_t * hp, void **items, size_t n);
+
+/**
+ * Cancel item in O(1)
+ *
+ * Rather than being removed the item is marked as cancelled, and is
+ * dropped once it reaches the top, so heap_peek() and heap_poll() never
+ * return it. When cancelled items make up more than the tombstone ratio
+ * of the array it is compacted in O(n). Suits timeouts, most of which are
+ * cancelled before they fire.
+ *
+ * The heap keeps pointing at a cancelled item until it is dropped, so the
+ * item must stay valid until then; see heap_compact(). Offering it again,
+ * with any of the offer functions, heap_pushpop() or heap_replace(), puts
+ * it back where it is, which is the cheap way to reschedule it. Its
+ * priority must not change while it is cancelled, except right before it
+ * is offered again, as for heap_update_item().
+ *
+ * Only for heaps whose items track their index; see
+ * heap_set_item_idx_offset().
+ *
+ * @param[in] item The item to cancel
+ * @return 0 on success; -1 if item does not exist, is already cancelled or
+ *  items don't track their index */
+int heap_cancel(heap_t * hp, const void *item);
+
+/**
+ * Remove all cancelled items from the heap's array now. O(n)
+ *
+ * Afterwards the heap holds no pointers to cancelled items. */
+void heap_compact(heap_t * hp);
+
+/**
+ * Set how many cancelled items the heap holds before it is compacted, as a
+ * share of all the items in its array. Defaults to 0.25.
+ *
+ * Lower ratios save memory and keep sifts shallow; higher ratios compact
+ * less often. With 1 they are only dropped from the top or by
+ * heap_compact().
+ *
+ * @param[in] ratio Greater than 0 and at most 1
+ * @return 0 on success; -1 if ratio is out of range */
+int heap_set_tombstone_ratio(heap_t * hp, double ratio);
+
+#ifdef HEAP_STATS
+/**
+ * Copy the heap's operation counters
+ *
+ * @param[out] stats Receives the counters */
+void heap_get_stats(const heap_t * hp, heap_stats_t * stats);
+
+/**
+ * Zero the heap's operation counters. high_water restarts at the current
+ * count. */
+void heap_reset_stats(heap_t * hp);
+#endif
+
 #endif /* HEAP_H */
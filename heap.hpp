@@ -0,0 +1,152 @@
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include <functional>
+#include <vector>
+
+namespace heap {
+
+/**
+ * A heap specialised for element type T; the C++ counterpart of
+ * HEAP_DEFINE in heap_define.h.
+ *
+ * Items are stored by value and Compare is inlined, so there is no
+ * indirect call per comparison.
+ *
+ * Compare(a, b) returns true if a has priority over b. The default,
+ * std::less<T>, gives a min-heap. */
+template <typename T, typename Compare = std::less<T> >
+class heap
+{
+public:
+    explicit heap(const Compare& less = Compare()) : less_(less) {}
+
+    /**
+     * Add item */
+    void offer(const T& item)
+    {
+        array_.push_back(item);
+        pushup(array_.size() - 1);
+    }
+
+    /**
+     * Remove the item with the top priority
+     *
+     * @return false if the heap is empty */
+    bool poll(T& item)
+    {
+        if (array_.empty())
+            return false;
+
+        item = array_[0];
+        array_[0] = array_.back();
+        array_.pop_back();
+        if (!array_.empty())
+            pushdown(0);
+        return true;
+    }
+
+    /**
+     * @return false if the heap is empty */
+    bool peek(T& item) const
+    {
+        if (array_.empty())
+            return false;
+
+        item = array_[0];
+        return true;
+    }
+
+    /**
+     * Remove the first item that is neither less nor greater than item
+     *
+     * @return false if no such item exists */
+    bool remove_item(const T& item)
+    {
+        size_t idx = find(item);
+
+        if (idx == array_.size())
+            return false;
+
+        array_[idx] = array_.back();
+        array_.pop_back();
+        if (idx != array_.size())
+        {
+            pushup(idx);
+            pushdown(idx);
+        }
+        return true;
+    }
+
+    bool contains_item(const T& item) const
+    {
+        return find(item) != array_.size();
+    }
+
+    void clear() { array_.clear(); }
+
+    size_t count() const { return array_.size(); }
+
+    size_t size() const { return array_.capacity(); }
+
+private:
+    size_t find(const T& item) const
+    {
+        size_t idx;
+
+        for (idx = 0; idx < array_.size(); idx++)
+            if (!less_(array_[idx], item) && !less_(item, array_[idx]))
+                break;
+        return idx;
+    }
+
+    void pushup(size_t idx)
+    {
+        T item = array_[idx];
+
+        while (0 != idx)
+        {
+            size_t parent = (idx - 1) / 2;
+
+            if (!less_(item, array_[parent]))
+                break;
+
+            array_[idx] = array_[parent];
+            idx = parent;
+        }
+
+        array_[idx] = item;
+    }
+
+    void pushdown(size_t idx)
+    {
+        T item = array_[idx];
+        size_t count = array_.size();
+
+        while (1)
+        {
+            size_t child = idx * 2 + 1;
+
+            if (child >= count)
+                break;
+
+            if (child + 1 < count && less_(array_[child + 1], array_[child]))
+                child++;
+
+            if (!less_(array_[child], item))
+                break;
+
+            array_[idx] = array_[child];
+            idx = child;
+        }
+
+        array_[idx] = item;
+    }
+
+    std::vector<T> array_;
+    Compare less_;
+};
+
+} /* namespace heap */
+
+#endif /* HEAP_HPP */
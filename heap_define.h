@@ -0,0 +1,204 @@
+#ifndef HEAP_DEFINE_H
+#define HEAP_DEFINE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Generate a heap specialised for element type T.
+ *
+ * Unlike heap_t, items are stored by value and compared with less, which
+ * is expanded inline so there is no indirect call per comparison.
+ *
+ * less(a, b) must evaluate to non-zero if a has priority over b. For
+ * example, a min-heap of ints:
+ *
+ *   #define int_less(a, b) ((a) < (b))
+ *   HEAP_DEFINE(intheap, int, int_less)
+ *
+ * which defines intheap_t and the following functions:
+ *
+ *   void name_init(name_t *h);
+ *   void name_release(name_t *h);             frees the array, not h
+ *   int name_offer(name_t *h, T item);        0 on success; -1 on failure
+ *   int name_poll(name_t *h, T *item);        0 on success; -1 if empty
+ *   int name_peek(const name_t *h, T *item);  0 on success; -1 if empty
+ *   int name_remove_item(name_t *h, T item, T *removed);
+ *   int name_contains_item(const name_t *h, T item);
+ *   void name_clear(name_t *h);
+ *   size_t name_count(const name_t *h);
+ *   size_t name_size(const name_t *h);
+ *
+ * As with heap_remove_item(), an item is found by a linear scan for an
+ * element that is neither less nor greater than it. */
+#define HEAP_DEFINE(name, T, less) \
+\
+typedef struct \
+{ \
+    /* size of array */ \
+    size_t size; \
+    /* items within heap */ \
+    size_t count; \
+    T *array; \
+} name##_t; \
+\
+static inline void name##_init(name##_t *h) \
+{ \
+    h->size = 0; \
+    h->count = 0; \
+    h->array = NULL; \
+} \
+\
+static inline void name##_release(name##_t *h) \
+{ \
+    free(h->array); \
+    name##_init(h); \
+} \
+\
+static inline void name##__pushup(name##_t *h, size_t idx) \
+{ \
+    T item = h->array[idx]; \
+\
+    while (0 != idx) \
+    { \
+        size_t parent = (idx - 1) / 2; \
+\
+        if (!(less(item, h->array[parent]))) \
+            break; \
+\
+        h->array[idx] = h->array[parent]; \
+        idx = parent; \
+    } \
+\
+    h->array[idx] = item; \
+} \
+\
+static inline void name##__pushdown(name##_t *h, size_t idx) \
+{ \
+    T item = h->array[idx]; \
+\
+    while (1) \
+    { \
+        size_t child = idx * 2 + 1; \
+\
+        if (child >= h->count) \
+            break; \
+\
+        if (child + 1 < h->count && less(h->array[child + 1], h->array[child])) \
+            child++; \
+\
+        if (!(less(h->array[child], item))) \
+            break; \
+\
+        h->array[idx] = h->array[child]; \
+        idx = child; \
+    } \
+\
+    h->array[idx] = item; \
+} \
+\
+static inline int name##_offer(name##_t *h, T item) \
+{ \
+    if (h->count == h->size) \
+    { \
+        size_t size = h->size ? h->size * 2 : 13; \
+        T *array; \
+\
+        /* grow by just one when doubling would overflow */ \
+        if (size < h->size || SIZE_MAX / sizeof(T) < size) \
+            size = h->size + 1; \
+        if (SIZE_MAX / sizeof(T) < size || \
+            !(array = (T *)realloc(h->array, size * sizeof(T)))) \
+            return -1; \
+\
+        h->array = array; \
+        h->size = size; \
+    } \
+\
+    h->array[h->count] = item; \
+    name##__pushup(h, h->count++); \
+    return 0; \
+} \
+\
+static inline int name##_peek(const name##_t *h, T *item) \
+{ \
+    if (0 == h->count) \
+        return -1; \
+\
+    *item = h->array[0]; \
+    return 0; \
+} \
+\
+static inline int name##_poll(name##_t *h, T *item) \
+{ \
+    if (0 == h->count) \
+        return -1; \
+\
+    *item = h->array[0]; \
+    h->count--; \
+    if (0 < h->count) \
+    { \
+        h->array[0] = h->array[h->count]; \
+        name##__pushdown(h, 0); \
+    } \
+    return 0; \
+} \
+\
+static inline int name##__item_get_idx(const name##_t *h, T item, \
+                                        size_t *idx) \
+{ \
+    size_t ii; \
+\
+    for (ii = 0; ii < h->count; ii++) \
+        if (!(less(h->array[ii], item)) && !(less(item, h->array[ii]))) \
+        { \
+            *idx = ii; \
+            return 0; \
+        } \
+\
+    return -1; \
+} \
+\
+static inline int name##_remove_item(name##_t *h, T item, T *removed) \
+{ \
+    size_t idx; \
+\
+    if (-1 == name##__item_get_idx(h, item, &idx)) \
+        return -1; \
+\
+    if (removed) \
+        *removed = h->array[idx]; \
+\
+    h->count--; \
+    if (idx != h->count) \
+    { \
+        h->array[idx] = h->array[h->count]; \
+        name##__pushup(h, idx); \
+        name##__pushdown(h, idx); \
+    } \
+    return 0; \
+} \
+\
+static inline int name##_contains_item(const name##_t *h, T item) \
+{ \
+    size_t idx; \
+\
+    return -1 != name##__item_get_idx(h, item, &idx); \
+} \
+\
+static inline void name##_clear(name##_t *h) \
+{ \
+    h->count = 0; \
+} \
+\
+static inline size_t name##_count(const name##_t *h) \
+{ \
+    return h->count; \
+} \
+\
+static inline size_t name##_size(const name##_t *h) \
+{ \
+    return h->size; \
+}
+
+#endif /* HEAP_DEFINE_H */
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+#include "heap_pool.h"
+
+/* matches DEFAULT_CAPACITY in heap.c */
+#define SMALLEST_CAPACITY 13
+
+/* pooled capacities are 13, 26, 52, ... 1664 items */
+#define NCLASSES 8
+
+typedef struct block_s
+{
+    struct block_s *next;
+} block_t;
+
+struct heap_pool_s
+{
+    heap_allocator_t alloc;
+    /* recycled blocks for each capacity */
+    block_t *free[NCLASSES];
+};
+
+/**
+ * @return the block size's class; -1 if it isn't pooled */
+static int __class(const size_t size)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < NCLASSES; ii++)
+        if (size == heap_sizeof(SMALLEST_CAPACITY << ii))
+            return ii;
+
+    return -1;
+}
+
+static void *__malloc(size_t size, void *ctx)
+{
+    heap_pool_t *pool = ctx;
+    int c = __class(size);
+    block_t *b;
+
+    if (-1 == c || !(b = pool->free[c]))
+        return malloc(size);
+
+    pool->free[c] = b->next;
+    return b;
+}
+
+static void __free(void *ptr, size_t size, void *ctx)
+{
+    heap_pool_t *pool = ctx;
+    int c = __class(size);
+    block_t *b = ptr;
+
+    if (-1 == c)
+    {
+        free(ptr);
+        return;
+    }
+
+    b->next = pool->free[c];
+    pool->free[c] = b;
+}
+
+static void *__realloc(void *ptr, size_t old_size, size_t new_size, void *ctx)
+{
+    void *new_ptr;
+
+    /* neither block is pooled so let realloc() avoid the copy if it can */
+    if (-1 == __class(old_size) && -1 == __class(new_size))
+        return realloc(ptr, new_size);
+
+    if (!(new_ptr = __malloc(new_size, ctx)))
+        return NULL;
+
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    __free(ptr, old_size, ctx);
+    return new_ptr;
+}
+
+heap_pool_t *heap_pool_new(void)
+{
+    heap_pool_t *pool = calloc(1, sizeof(heap_pool_t));
+
+    if (!pool)
+        return NULL;
+
+    pool->alloc.malloc = __malloc;
+    pool->alloc.realloc = __realloc;
+    pool->alloc.free = __free;
+    pool->alloc.ctx = pool;
+
+    return pool;
+}
+
+void heap_pool_free(heap_pool_t * pool)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < NCLASSES; ii++)
+        while (pool->free[ii])
+        {
+            block_t *b = pool->free[ii];
+
+            pool->free[ii] = b->next;
+            free(b);
+        }
+
+    free(pool);
+}
+
+const heap_allocator_t *heap_pool_allocator(heap_pool_t * pool)
+{
+    return &pool->alloc;
+}
+
+/*--------------------------------------------------------------79-characters-*/
@@ -0,0 +1,32 @@
+#ifndef HEAP_POOL_H
+#define HEAP_POOL_H
+
+#include "heap.h"
+
+/**
+ * A pool of recycled heap_t blocks for programs that create and free many
+ * small heaps.
+ *
+ * Blocks of the capacities a heap passes through as it grows from
+ * heap_new() (13, 26, 52, ... items) are kept on free lists once freed and
+ * handed out again. In steady state no call reaches the system allocator.
+ * Other sizes fall through to malloc().
+ *
+ * The pool is not thread-safe; use one per thread. */
+typedef struct heap_pool_s heap_pool_t;
+
+/**
+ * @return new empty pool; NULL on failure */
+heap_pool_t *heap_pool_new(void);
+
+/**
+ * Release the pool and all the blocks it has cached.
+ *
+ * No heap using the pool may still exist. */
+void heap_pool_free(heap_pool_t * pool);
+
+/**
+ * @return allocator to pass to heap_new_ex() */
+const heap_allocator_t *heap_pool_allocator(heap_pool_t * pool);
+
+#endif /* HEAP_POOL_H */
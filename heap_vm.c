@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "heap.h"
+#include "heap_vm.h"
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+/* used when the kernel doesn't report its huge page size */
+#define DEFAULT_HUGE_PAGE_SIZE (2UL << 20)
+
+/**
+ * Lives in the first page of the reservation; the heap starts on the
+ * next page */
+typedef struct
+{
+    heap_allocator_t alloc;
+    /* length of the whole mapping */
+    size_t length;
+    /* page size of the mapping; the heap starts this far in */
+    size_t page;
+} reservation_t;
+
+static size_t __page_size(void)
+{
+    return sysconf(_SC_PAGESIZE);
+}
+
+static size_t __huge_page_size(void)
+{
+    size_t size = DEFAULT_HUGE_PAGE_SIZE;
+    char line[128];
+    unsigned long kb;
+    FILE *f;
+
+    if (!(f = fopen("/proc/meminfo", "r")))
+        return size;
+
+    while (fgets(line, sizeof(line), f))
+        if (1 == sscanf(line, "Hugepagesize: %lu kB", &kb))
+        {
+            size = kb << 10;
+            break;
+        }
+
+    fclose(f);
+    return size;
+}
+
+static size_t __round_up(size_t n, size_t align)
+{
+    return (n + align - 1) / align * align;
+}
+
+static void *__malloc(size_t size, void *ctx)
+{
+    reservation_t *r = ctx;
+
+    if (r->page + size > r->length)
+        return NULL;
+
+    return (char *)r + r->page;
+}
+
+static void *__realloc(void *ptr, size_t old_size, size_t new_size, void *ctx)
+{
+    reservation_t *r = ctx;
+
+    (void)old_size;
+
+    /* the pages are already mapped; they are committed on first touch */
+    if (r->page + new_size > r->length)
+        return NULL;
+
+    return ptr;
+}
+
+static void __free(void *ptr, size_t size, void *ctx)
+{
+    reservation_t *r = ctx;
+
+    (void)ptr;
+    (void)size;
+
+    munmap(r, r->length);
+}
+
+/**
+ * Map a page for the reservation header plus size bytes, with the start of
+ * the mapping aligned to align
+ *
+ * @return the reservation; NULL on failure */
+static reservation_t *__map(size_t size, size_t page, size_t align,
+                            int flags)
+{
+    size_t length = page + __round_up(size, page);
+    size_t slop = page < align ? align : 0;
+    char *base, *start;
+    reservation_t *r;
+
+    base = mmap(NULL, length + slop, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if (MAP_FAILED == base)
+        return NULL;
+
+    /* trim the mapping so that it starts on an aligned address */
+    if (slop)
+    {
+        start = (char *)__round_up((uintptr_t)base, align);
+        if (base < start)
+            munmap(base, start - base);
+        if (start - base < (ptrdiff_t)slop)
+            munmap(start + length, slop - (start - base));
+        base = start;
+    }
+
+    r = (reservation_t *)base;
+    r->alloc.malloc = __malloc;
+    r->alloc.realloc = __realloc;
+    r->alloc.free = __free;
+    r->alloc.ctx = r;
+    r->length = length;
+    r->page = page;
+    return r;
+}
+
+heap_t *heap_new_reserved(int (*cmp) (const void *,
+                                      const void *,
+                                      const void *udata),
+                          const void *udata,
+                          size_t max_items)
+{
+    return heap_new_reserved_ex(cmp, udata, max_items, 0);
+}
+
+heap_t *heap_new_reserved_ex(int (*cmp) (const void *,
+                                         const void *,
+                                         const void *udata),
+                             const void *udata,
+                             size_t max_items,
+                             int flags)
+{
+    size_t page = __page_size();
+    reservation_t *r = NULL;
+    size_t size;
+    heap_t *h;
+
+    /* leave room for rounding up to whole pages */
+    if ((SIZE_MAX / 2 - heap_sizeof(0)) / sizeof(void *) < max_items)
+        return NULL;
+    size = heap_sizeof(max_items);
+
+#ifdef MAP_HUGETLB
+    /* no MAP_NORESERVE: if the huge page pool is too small we want mmap()
+     * to fail now, rather than SIGBUS when a page is first touched */
+    if (flags & HEAP_VM_HUGETLB)
+        if (!(r = __map(size, __huge_page_size(), 0, MAP_HUGETLB)))
+            flags |= HEAP_VM_HUGEPAGES;
+#endif
+
+    if (!r)
+    {
+        size_t huge = flags & HEAP_VM_HUGEPAGES ? __huge_page_size() : 0;
+
+        /* transparent huge pages are only used for aligned ranges */
+        if (!(r = __map(size, page, huge, MAP_NORESERVE)))
+            return NULL;
+
+#ifdef MADV_HUGEPAGE
+        if (huge)
+            madvise(r, r->length, MADV_HUGEPAGE);
+#endif
+    }
+
+    if (!(h = heap_new_ex(cmp, udata, &r->alloc)))
+        munmap(r, r->length);
+
+    return h;
+}
+
+/*--------------------------------------------------------------79-characters-*/
@@ -0,0 +1,58 @@
+#ifndef HEAP_VM_H
+#define HEAP_VM_H
+
+#include "heap.h"
+
+/**
+ * Flags for heap_new_reserved_ex() */
+enum {
+    /* ask for transparent huge pages with madvise(MADV_HUGEPAGE) */
+    HEAP_VM_HUGEPAGES = 1 << 0,
+    /* use explicit huge pages (MAP_HUGETLB) from the kernel's pool; falls
+     * back to HEAP_VM_HUGEPAGES if the pool can't satisfy the mapping */
+    HEAP_VM_HUGETLB = 1 << 1,
+};
+
+/**
+ * Create a heap backed by a virtual memory reservation.
+ *
+ * Address space for max_items is reserved up front, but pages are only
+ * committed as the heap grows into them. The heap never moves, so
+ * heap_offer() never changes the heap pointer and never copies the array.
+ * Growth is O(1).
+ *
+ * heap_offer() fails once max_items is reached.
+ *
+ * Free with heap_free().
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @param[in] max_items Most items the heap can ever hold
+ * @return initialised heap; NULL on failure */
+heap_t *heap_new_reserved(int (*cmp) (const void *,
+                                      const void *,
+                                      const void *udata),
+                          const void *udata,
+                          size_t max_items);
+
+/**
+ * Create a heap backed by a virtual memory reservation.
+ *
+ * As heap_new_reserved(), optionally backed by huge pages. On very large
+ * heaps most of the cost of a sift is TLB misses; a 2MB page covers 512
+ * times as many items as a 4KB one. Huge pages are a hint: when they
+ * aren't available the heap silently uses normal pages.
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @param[in] max_items Most items the heap can ever hold
+ * @param[in] flags Zero or more HEAP_VM_* flags
+ * @return initialised heap; NULL on failure */
+heap_t *heap_new_reserved_ex(int (*cmp) (const void *,
+                                         const void *,
+                                         const void *udata),
+                             const void *udata,
+                             size_t max_items,
+                             int flags);
+
+#endif /* HEAP_VM_H */
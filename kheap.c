@@ -0,0 +1,381 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "kheap.h"
+
+#define DEFAULT_CAPACITY 13
+
+/* snapshot file format; bump the version whenever the layout changes */
+#define FILE_MAGIC "kheap\0\0\0"
+#define FILE_VERSION 1
+#define FILE_BYTE_ORDER 0x01020304u
+/* entries start this far into the file */
+#define FILE_DATA_OFFSET 64
+
+/* 4 children of 16 bytes each span a single cache line */
+#define ARITY_LOG2 2
+
+typedef struct
+{
+    uint64_t key;
+    void *item;
+} kheap_entry_t;
+
+struct kheap_s
+{
+    /* size of array */
+    size_t size;
+    /* items within heap */
+    size_t count;
+    /* length of the snapshot file mapping the heap lives in; 0 if the
+     * heap was malloc()ed */
+    size_t mapping;
+    kheap_entry_t array[];
+};
+
+/**
+ * Snapshot file header. Everything needed to tell whether the entries can
+ * be used as they are by this build */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    /* FILE_BYTE_ORDER as written by the saving machine */
+    uint32_t byte_order;
+    uint32_t entry_size;
+    uint32_t arity_log2;
+    uint64_t count;
+} kheap_file_header_t;
+
+/* a mapped heap's struct overlaps the tail of the header padding */
+typedef char __kheap_file_header_fits[
+    sizeof(kheap_file_header_t) + offsetof(kheap_t, array) <=
+    FILE_DATA_OFFSET ? 1 : -1];
+
+size_t kheap_sizeof(size_t size)
+{
+    return sizeof(kheap_t) + size * sizeof(kheap_entry_t);
+}
+
+/**
+ * @return the most entries a heap can hold without kheap_sizeof()
+ *  overflowing */
+static size_t __max_size(void)
+{
+    return (SIZE_MAX - sizeof(kheap_t)) / sizeof(kheap_entry_t);
+}
+
+static size_t __child_first(const size_t idx)
+{
+    return (idx << ARITY_LOG2) + 1;
+}
+
+static size_t __parent(const size_t idx)
+{
+    return (idx - 1) >> ARITY_LOG2;
+}
+
+void kheap_init(kheap_t * h, size_t size)
+{
+    h->size = size;
+    h->count = 0;
+    h->mapping = 0;
+}
+
+kheap_t *kheap_new(void)
+{
+    kheap_t *h = malloc(kheap_sizeof(DEFAULT_CAPACITY));
+
+    if (!h)
+        return NULL;
+
+    kheap_init(h, DEFAULT_CAPACITY);
+
+    return h;
+}
+
+/**
+ * @return start of the snapshot file mapping that h lives in */
+static char *__mapping_base(kheap_t * h)
+{
+    return (char *)h->array - FILE_DATA_OFFSET;
+}
+
+void kheap_free(kheap_t * h)
+{
+    if (h->mapping)
+        munmap(__mapping_base(h), h->mapping);
+    else
+        free(h);
+}
+
+/**
+ * @return a new heap on success; NULL otherwise, leaving h untouched */
+static kheap_t *__ensurecapacity(kheap_t * h)
+{
+    size_t size = h->size * 2;
+    kheap_t *new_h;
+
+    if (h->count < h->size)
+        return h;
+
+    if (__max_size() <= h->size)
+        return NULL;
+
+    /* a snapshot of an empty heap has no room at all */
+    if (0 == h->size)
+        size = DEFAULT_CAPACITY;
+    else if (size < h->size || __max_size() < size)
+        size = __max_size();
+
+    /* a mapped heap moves to the malloc() heap the first time it grows */
+    if (h->mapping)
+    {
+        if (!(new_h = malloc(kheap_sizeof(size))))
+            return NULL;
+        memcpy(new_h->array, h->array, h->count * sizeof(kheap_entry_t));
+        new_h->count = h->count;
+        new_h->mapping = 0;
+        kheap_free(h);
+    }
+    else if (!(new_h = realloc(h, kheap_sizeof(size))))
+        return NULL;
+
+    new_h->size = size;
+    return new_h;
+}
+
+/**
+ * Move the entry up from idx into its place.
+ * Parents are shifted down into the hole rather than swapped. */
+static void __pushup(kheap_t * h, size_t idx)
+{
+    kheap_entry_t e = h->array[idx];
+
+    while (0 != idx)
+    {
+        size_t parent = __parent(idx);
+
+        if (h->array[parent].key <= e.key)
+            break;
+
+        h->array[idx] = h->array[parent];
+        idx = parent;
+    }
+
+    h->array[idx] = e;
+}
+
+static void __pushdown(kheap_t * h, size_t idx)
+{
+    kheap_entry_t e = h->array[idx];
+
+    while (1)
+    {
+        size_t child, last, c;
+
+        child = __child_first(idx);
+
+        if (child >= h->count)
+            break;
+
+        last = child + ((size_t)1 << ARITY_LOG2);
+        if (last > h->count)
+            last = h->count;
+
+        /* find smallest child */
+        for (c = child + 1; c < last; c++)
+            if (h->array[c].key < h->array[child].key)
+                child = c;
+
+        if (e.key <= h->array[child].key)
+            break;
+
+        h->array[idx] = h->array[child];
+        idx = child;
+    }
+
+    h->array[idx] = e;
+}
+
+static void __kheap_offerx(kheap_t * h, uint64_t key, void *item)
+{
+    h->array[h->count].key = key;
+    h->array[h->count].item = item;
+
+    /* ensure heap properties */
+    __pushup(h, h->count++);
+}
+
+int kheap_offerx(kheap_t * h, uint64_t key, void *item)
+{
+    if (h->count == h->size)
+        return -1;
+    __kheap_offerx(h, key, item);
+    return 0;
+}
+
+int kheap_offer(kheap_t ** h, uint64_t key, void *item)
+{
+    kheap_t *new_h = __ensurecapacity(*h);
+
+    if (!new_h)
+        return -1;
+
+    *h = new_h;
+    __kheap_offerx(*h, key, item);
+    return 0;
+}
+
+void *kheap_poll(kheap_t * h, uint64_t *key)
+{
+    if (0 == h->count)
+        return NULL;
+
+    void *item = h->array[0].item;
+
+    if (key)
+        *key = h->array[0].key;
+
+    h->count--;
+    if (0 < h->count)
+    {
+        h->array[0] = h->array[h->count];
+        __pushdown(h, 0);
+    }
+
+    return item;
+}
+
+void *kheap_peek(const kheap_t * h, uint64_t *key)
+{
+    if (0 == h->count)
+        return NULL;
+
+    if (key)
+        *key = h->array[0].key;
+
+    return h->array[0].item;
+}
+
+void kheap_clear(kheap_t * h)
+{
+    h->count = 0;
+}
+
+size_t kheap_count(const kheap_t * h)
+{
+    return h->count;
+}
+
+size_t kheap_size(const kheap_t * h)
+{
+    return h->size;
+}
+
+static int __write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+
+    while (0 < len)
+    {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0)
+        {
+            if (EINTR == errno)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+int kheap_save(const kheap_t * h, int fd)
+{
+    char header[FILE_DATA_OFFSET];
+    kheap_file_header_t *fh = (kheap_file_header_t *)header;
+
+    memset(header, 0, sizeof(header));
+    memcpy(fh->magic, FILE_MAGIC, sizeof(fh->magic));
+    fh->version = FILE_VERSION;
+    fh->byte_order = FILE_BYTE_ORDER;
+    fh->entry_size = sizeof(kheap_entry_t);
+    fh->arity_log2 = ARITY_LOG2;
+    fh->count = h->count;
+
+    if (-1 == __write_all(fd, header, sizeof(header)))
+        return -1;
+
+    return __write_all(fd, h->array, h->count * sizeof(kheap_entry_t));
+}
+
+/**
+ * @return 0 if the header describes a file of this length that this build
+ * can use as it is; otherwise -1 */
+static int __check_header(const kheap_file_header_t *fh, size_t length)
+{
+    if (0 != memcmp(fh->magic, FILE_MAGIC, sizeof(fh->magic)) ||
+        FILE_VERSION != fh->version ||
+        FILE_BYTE_ORDER != fh->byte_order ||
+        sizeof(kheap_entry_t) != fh->entry_size ||
+        ARITY_LOG2 != fh->arity_log2 ||
+        __max_size() < fh->count ||
+        (length - FILE_DATA_OFFSET) / sizeof(kheap_entry_t) != fh->count ||
+        (length - FILE_DATA_OFFSET) % sizeof(kheap_entry_t))
+        return -1;
+
+    return 0;
+}
+
+kheap_t *kheap_map(const char *path)
+{
+    kheap_file_header_t fh;
+    struct stat st;
+    size_t length;
+    char *base;
+    kheap_t *h;
+    int fd;
+
+    if (-1 == (fd = open(path, O_RDONLY)))
+        return NULL;
+
+    if (-1 == fstat(fd, &st) || st.st_size < FILE_DATA_OFFSET)
+    {
+        close(fd);
+        return NULL;
+    }
+    length = st.st_size;
+
+    /* private and writable: pages are copied when the heap first changes
+     * them, and the file itself is never written */
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base)
+        return NULL;
+
+    memcpy(&fh, base, sizeof(fh));
+    if (-1 == __check_header(&fh, length))
+    {
+        munmap(base, length);
+        return NULL;
+    }
+
+    h = (kheap_t *)(base + FILE_DATA_OFFSET - offsetof(kheap_t, array));
+    h->size = fh.count;
+    h->count = fh.count;
+    h->mapping = length;
+    return h;
+}
+
+/*--------------------------------------------------------------79-characters-*/
@@ -0,0 +1,137 @@
+#ifndef KHEAP_H
+#define KHEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A heap that stores each item's priority inline next to the item pointer.
+ *
+ * Comparisons only touch the heap's own array and need no callback. The
+ * item with the lowest key is at the top. */
+typedef struct kheap_s kheap_t;
+
+/**
+ * Create new heap and initialise it.
+ *
+ * malloc()s space for heap.
+ *
+ * @return initialised heap */
+kheap_t *kheap_new(void);
+
+/**
+ * Initialise heap. Use memory passed by user.
+ *
+ * No malloc()s are performed.
+ *
+ * @param[in] size Initial size of the heap's array */
+void kheap_init(kheap_t * hp, size_t size);
+
+void kheap_free(kheap_t * hp);
+
+/**
+ * Add item
+ *
+ * Ensures that the data structure can hold the item.
+ *
+ * NOTE:
+ *  realloc() possibly called.
+ *  The heap pointer will be changed if the heap needs to be enlarged.
+ *
+ * @param[in/out] hp_ptr Pointer to the heap. Changed when heap is enlarged.
+ * @param[in] key The item's priority; lower keys are polled first
+ * @param[in] item The item to be added
+ * @return 0 on success; -1 on failure */
+int kheap_offer(kheap_t ** hp_ptr, uint64_t key, void *item);
+
+/**
+ * Add item
+ *
+ * An error will occur if there isn't enough space for this item.
+ *
+ * NOTE:
+ *  no malloc()s called.
+ *
+ * @param[in] key The item's priority; lower keys are polled first
+ * @param[in] item The item to be added
+ * @return 0 on success; -1 on error */
+int kheap_offerx(kheap_t * hp, uint64_t key, void *item);
+
+/**
+ * Remove the item with the lowest key
+ *
+ * @param[out] key Set to the item's key; may be NULL
+ * @return top item; NULL if the heap is empty */
+void *kheap_poll(kheap_t * hp, uint64_t *key);
+
+/**
+ * @param[out] key Set to the top item's key; may be NULL
+ * @return top item of the heap; NULL if the heap is empty */
+void *kheap_peek(const kheap_t * hp, uint64_t *key);
+
+/**
+ * Clear all items
+ *
+ * NOTE:
+ *  Does not free items. */
+void kheap_clear(kheap_t * hp);
+
+/**
+ * @return number of items in heap */
+size_t kheap_count(const kheap_t * hp);
+
+/**
+ * @return size of array */
+size_t kheap_size(const kheap_t * hp);
+
+/**
+ * @return number of bytes needed for a heap of this size. */
+size_t kheap_sizeof(size_t size);
+
+/**
+ * Write a snapshot of the heap to a file
+ *
+ * The array is written as it is, already in heap order, behind a versioned
+ * header. Items are saved as their bit patterns, so a heap that will be
+ * reloaded by another process should hold indices or IDs cast to void *
+ * rather than pointers.
+ *
+ * @param[in] fd File descriptor open for writing
+ * @return 0 on success; -1 on error */
+int kheap_save(const kheap_t * hp, int fd);
+
+/**
+ * Load a snapshot written by kheap_save()
+ *
+ * The file is mmap()ed and used in place with no re-sifting, so loading
+ * costs only the page faults of the pages that are touched. The mapping
+ * is private: changes to the heap are never written back to the file.
+ * The heap moves to malloc()ed memory the first time it needs to grow.
+ *
+ * Free with kheap_free().
+ *
+ * @param[in] path Snapshot file
+ * @return the heap; NULL if the file can't be read or was written by an
+ *  incompatible build */
+kheap_t *kheap_map(const char *path);
+
+/**
+ * Map a signed key onto an unsigned key with the same ordering */
+static inline uint64_t kheap_key_from_int64(int64_t key)
+{
+    return (uint64_t)key ^ ((uint64_t)1 << 63);
+}
+
+/**
+ * Map a double onto an unsigned key with the same ordering.
+ *
+ * NaNs sort after +inf (or before -inf if their sign bit is set). */
+static inline uint64_t kheap_key_from_double(double key)
+{
+    union { double d; uint64_t u; } v;
+
+    v.d = key;
+    return v.u >> 63 ? ~v.u : v.u | ((uint64_t)1 << 63);
+}
+
+#endif /* KHEAP_H */
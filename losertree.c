@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "losertree.h"
+
+enum {
+    MODE_CMP,
+    MODE_U64,
+    MODE_STR,
+};
+
+typedef struct
+{
+    /* the run's current item; NULL once the run is exhausted */
+    void *item;
+    /* the current item's key, for MODE_U64 */
+    uint64_t key;
+    void *run;
+} leaf_t;
+
+struct losertree_s
+{
+    /* number of runs */
+    unsigned int k;
+    int mode;
+    /**  user data */
+    const void *udata;
+    int (*cmp) (const void *, const void *, const void *);
+    void *(*next) (void *run);
+    /* offset of the uint64_t key inside each item, for MODE_U64 */
+    size_t key_offset;
+    /* tree[0] is the winning leaf; tree[1..k-1] hold the losers. Leaf i
+     * sits below node (k + i) / 2 */
+    unsigned int *tree;
+    leaf_t leaves[];
+};
+
+/**
+ * @return non-zero if leaf a comes out before leaf b. mode is passed
+ * separately so that each mode gets its own inlined copy */
+static inline int __beats(const losertree_t * lt, unsigned int a,
+                          unsigned int b, const int mode)
+{
+    const leaf_t *la = &lt->leaves[a], *lb = &lt->leaves[b];
+    int c;
+
+    /* exhausted runs lose every match */
+    if (!lb->item)
+        return 1;
+    if (!la->item)
+        return 0;
+
+    switch (mode)
+    {
+    case MODE_U64:
+        if (la->key != lb->key)
+            return la->key < lb->key;
+        break;
+    case MODE_STR:
+        if (0 != (c = strcmp(la->item, lb->item)))
+            return c < 0;
+        break;
+    default:
+        if (0 != (c = lt->cmp(la->item, lb->item, lt->udata)))
+            return 0 < c;
+        break;
+    }
+
+    /* ties go to the earlier run */
+    return a < b;
+}
+
+/**
+ * Move the leaf's run on to its next item */
+static void __advance(losertree_t * lt, unsigned int idx)
+{
+    leaf_t *l = &lt->leaves[idx];
+
+    l->item = lt->next(l->run);
+    if (l->item && MODE_U64 == lt->mode)
+        l->key = *(uint64_t *)((char *)l->item + lt->key_offset);
+}
+
+/**
+ * Play the leaf's matches on the path to the root */
+static inline void __replay_mode(losertree_t * lt, unsigned int winner,
+                                 const int mode)
+{
+    unsigned int node;
+
+    for (node = (lt->k + winner) / 2; 0 < node; node /= 2)
+        if (__beats(lt, lt->tree[node], winner, mode))
+        {
+            unsigned int tmp = lt->tree[node];
+
+            lt->tree[node] = winner;
+            winner = tmp;
+        }
+
+    lt->tree[0] = winner;
+}
+
+static void __replay(losertree_t * lt, unsigned int winner)
+{
+    switch (lt->mode)
+    {
+    case MODE_U64:
+        __replay_mode(lt, winner, MODE_U64);
+        break;
+    case MODE_STR:
+        __replay_mode(lt, winner, MODE_STR);
+        break;
+    default:
+        __replay_mode(lt, winner, MODE_CMP);
+        break;
+    }
+}
+
+/**
+ * Play every match from scratch
+ *
+ * @return 0 on success; -1 on failure */
+static int __build(losertree_t * lt)
+{
+    unsigned int *winners, n;
+
+    if (!(winners = malloc(2 * lt->k * sizeof(*winners))))
+        return -1;
+
+    for (n = 0; n < lt->k; n++)
+        winners[lt->k + n] = n;
+
+    for (n = lt->k - 1; 0 < n; n--)
+    {
+        unsigned int a = winners[2 * n], b = winners[2 * n + 1];
+
+        if (__beats(lt, a, b, lt->mode))
+        {
+            winners[n] = a;
+            lt->tree[n] = b;
+        }
+        else
+        {
+            winners[n] = b;
+            lt->tree[n] = a;
+        }
+    }
+
+    lt->tree[0] = winners[1];
+    free(winners);
+    return 0;
+}
+
+static losertree_t *__new(int mode,
+                          int (*cmp) (const void *,
+                                      const void *,
+                                      const void *udata),
+                          const void *udata,
+                          size_t key_offset,
+                          void *(*next) (void *run),
+                          void **runs,
+                          unsigned int k)
+{
+    /* no runs is treated as one run that is already exhausted */
+    unsigned int n = k ? k : 1;
+    losertree_t *lt;
+    unsigned int ii;
+
+    lt = malloc(sizeof(losertree_t) + n * sizeof(leaf_t) +
+                n * sizeof(unsigned int));
+    if (!lt)
+        return NULL;
+
+    lt->k = n;
+    lt->mode = mode;
+    lt->udata = udata;
+    lt->cmp = cmp;
+    lt->next = next;
+    lt->key_offset = key_offset;
+    lt->tree = (unsigned int *)&lt->leaves[n];
+    lt->leaves[0].item = NULL;
+
+    /* read the first item of each run */
+    for (ii = 0; ii < k; ii++)
+    {
+        lt->leaves[ii].run = runs[ii];
+        __advance(lt, ii);
+    }
+
+    if (-1 == __build(lt))
+    {
+        free(lt);
+        return NULL;
+    }
+
+    return lt;
+}
+
+losertree_t *losertree_new(int (*cmp) (const void *,
+                                       const void *,
+                                       const void *udata),
+                           const void *udata,
+                           void *(*next) (void *run),
+                           void **runs,
+                           unsigned int k)
+{
+    return __new(MODE_CMP, cmp, udata, 0, next, runs, k);
+}
+
+losertree_t *losertree_new_u64(size_t key_offset,
+                               void *(*next) (void *run),
+                               void **runs,
+                               unsigned int k)
+{
+    return __new(MODE_U64, NULL, NULL, key_offset, next, runs, k);
+}
+
+losertree_t *losertree_new_str(void *(*next) (void *run),
+                               void **runs,
+                               unsigned int k)
+{
+    return __new(MODE_STR, NULL, NULL, 0, next, runs, k);
+}
+
+void losertree_free(losertree_t * lt)
+{
+    free(lt);
+}
+
+void *losertree_poll(losertree_t * lt)
+{
+    unsigned int winner = lt->tree[0];
+    void *item = lt->leaves[winner].item;
+
+    if (!item)
+        return NULL;
+
+    __advance(lt, winner);
+    __replay(lt, winner);
+    return item;
+}
+
+size_t losertree_poll_n(losertree_t * lt, void **out, size_t n)
+{
+    size_t ii;
+    void *item;
+
+    /* nothing is written past the items returned */
+    for (ii = 0; ii < n && (item = losertree_poll(lt)); ii++)
+        out[ii] = item;
+
+    return ii;
+}
+
+void *losertree_peek(const losertree_t * lt)
+{
+    return lt->leaves[lt->tree[0]].item;
+}
+
+/*--------------------------------------------------------------79-characters-*/
@@ -0,0 +1,96 @@
+#ifndef LOSERTREE_H
+#define LOSERTREE_H
+
+#include <stddef.h>
+
+/**
+ * A tournament (loser) tree for merging k sorted runs.
+ *
+ * Each internal node holds the run that lost the match played there, and
+ * the overall winner is kept at the top. Taking the winner and advancing
+ * its run replays a single leaf-to-root path: log2(k) comparisons, against
+ * about 2 log2(k) for a heap_poll() plus heap_offer().
+ *
+ * Runs are read through a next callback, which returns a run's next item
+ * or NULL once the run is exhausted. Items come out in the order that
+ * heap_poll() would give: the item that cmp ranks highest first. Items
+ * that compare equal come out in run order, so the merge is stable.
+ *
+ * Runs must already be sorted in that order. */
+typedef struct losertree_s losertree_t;
+
+/**
+ * Create a merge of k runs.
+ *
+ * malloc()s space for the tree. The first item of each run is read
+ * straight away.
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @param[in] next Callback that returns a run's next item; NULL at its end
+ * @param[in] runs The runs; passed to next
+ * @param[in] k Number of runs
+ * @return initialised tree; NULL on failure */
+losertree_t *losertree_new(int (*cmp) (const void *,
+                                       const void *,
+                                       const void *udata),
+                           const void *udata,
+                           void *(*next) (void *run),
+                           void **runs,
+                           unsigned int k);
+
+/**
+ * Create a merge of k runs, ordered by an integer key with no callback.
+ *
+ * Each item must have a uint64_t at the given offset (eg. obtained with
+ * offsetof()). Items with the lowest key come out first.
+ *
+ * @param[in] key_offset Byte offset of the key within each item
+ * @param[in] next Callback that returns a run's next item; NULL at its end
+ * @param[in] runs The runs; passed to next
+ * @param[in] k Number of runs
+ * @return initialised tree; NULL on failure */
+losertree_t *losertree_new_u64(size_t key_offset,
+                               void *(*next) (void *run),
+                               void **runs,
+                               unsigned int k);
+
+/**
+ * Create a merge of k runs of NUL-terminated strings, with no callback.
+ *
+ * Items are the strings themselves, and come out in strcmp() order.
+ *
+ * @param[in] next Callback that returns a run's next string; NULL at its
+ *  end
+ * @param[in] runs The runs; passed to next
+ * @param[in] k Number of runs
+ * @return initialised tree; NULL on failure */
+losertree_t *losertree_new_str(void *(*next) (void *run),
+                               void **runs,
+                               unsigned int k);
+
+/**
+ * NOTE:
+ *  Does not free runs or items. */
+void losertree_free(losertree_t * lt);
+
+/**
+ * Remove the next item of the merge
+ *
+ * @return next item; NULL once every run is exhausted */
+void *losertree_poll(losertree_t * lt);
+
+/**
+ * Remove up to n items of the merge
+ *
+ * @param[out] out Array that receives the items in merge order
+ * @param[in] n Maximum number of items to remove
+ * @return number of items removed; less than n only once every run is
+ *  exhausted */
+size_t losertree_poll_n(losertree_t * lt, void **out, size_t n);
+
+/**
+ * @return next item of the merge; NULL once every run is exhausted */
+void *losertree_peek(const losertree_t * lt);
+
+#endif /* LOSERTREE_H */
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mmheap.h"
+
+#define DEFAULT_CAPACITY 13
+
+struct mmheap_s
+{
+    /* size of array */
+    size_t size;
+    /* items within heap */
+    size_t count;
+    /**  user data */
+    const void *udata;
+    int (*cmp) (const void *, const void *, const void *);
+    void * array[];
+};
+
+static size_t __sizeof(size_t size)
+{
+    return sizeof(mmheap_t) + size * sizeof(void *);
+}
+
+/**
+ * @return the most items a heap can hold without __sizeof() overflowing */
+static size_t __max_size(void)
+{
+    return (SIZE_MAX - sizeof(mmheap_t)) / sizeof(void *);
+}
+
+/**
+ * Levels alternate, starting with the root on a max level. Items on a max
+ * level have a higher priority than everything below them; items on a
+ * min level a lower one.
+ *
+ * @return non-zero if idx is on a max level */
+static int __is_max_level(size_t idx)
+{
+    int max = 1;
+
+    for (idx++; 1 < idx; idx >>= 1)
+        max = !max;
+    return max;
+}
+
+/**
+ * @return non-zero if the item at a comes before the item at b. On max
+ * levels that is the higher priority item; on min levels the lower */
+static int __before(const mmheap_t * h, size_t a, size_t b, int max)
+{
+    int c = h->cmp(h->array[a], h->array[b], h->udata);
+
+    return max ? 0 < c : c < 0;
+}
+
+static void __swap(mmheap_t * h, size_t i1, size_t i2)
+{
+    void *tmp = h->array[i1];
+
+    h->array[i1] = h->array[i2];
+    h->array[i2] = tmp;
+}
+
+/**
+ * Sift up through grandparents, which are on levels of the same kind */
+static void __pushup_level(mmheap_t * h, size_t idx, int max)
+{
+    while (2 < idx)
+    {
+        size_t grandparent = ((idx - 1) / 2 - 1) / 2;
+
+        if (!__before(h, idx, grandparent, max))
+            return;
+
+        __swap(h, idx, grandparent);
+        idx = grandparent;
+    }
+}
+
+static void __pushup(mmheap_t * h, size_t idx)
+{
+    int max = __is_max_level(idx);
+    size_t parent;
+
+    if (0 == idx)
+        return;
+
+    parent = (idx - 1) / 2;
+
+    /* the parent is on the other kind of level; if the item belongs there
+     * it continues up that kind of level instead */
+    if (__before(h, parent, idx, max))
+    {
+        __swap(h, idx, parent);
+        __pushup_level(h, parent, !max);
+    }
+    else
+        __pushup_level(h, idx, max);
+}
+
+static void __pushdown(mmheap_t * h, size_t idx)
+{
+    int max = __is_max_level(idx);
+
+    while (1)
+    {
+        size_t child = 2 * idx + 1, best, ii, last;
+
+        if (child >= h->count)
+            return;
+
+        /* find the best of the children and grandchildren */
+        best = child;
+        if (child + 1 < h->count && __before(h, child + 1, best, max))
+            best = child + 1;
+
+        last = 4 * idx + 7;
+        if (last > h->count)
+            last = h->count;
+        for (ii = 4 * idx + 3; ii < last; ii++)
+            if (__before(h, ii, best, max))
+                best = ii;
+
+        if (!__before(h, best, idx, max))
+            return;
+
+        __swap(h, best, idx);
+
+        /* a child is a leaf of this subtree; we're done */
+        if (best <= child + 1)
+            return;
+
+        /* the item moved down two levels, past a level of the other kind */
+        if (__before(h, (best - 1) / 2, best, max))
+            __swap(h, best, (best - 1) / 2);
+
+        idx = best;
+    }
+}
+
+mmheap_t *mmheap_new(int (*cmp) (const void *,
+                                 const void *,
+                                 const void *udata),
+                     const void *udata)
+{
+    mmheap_t *h = malloc(__sizeof(DEFAULT_CAPACITY));
+
+    if (!h)
+        return NULL;
+
+    h->cmp = cmp;
+    h->udata = udata;
+    h->size = DEFAULT_CAPACITY;
+    h->count = 0;
+
+    return h;
+}
+
+void mmheap_free(mmheap_t * h)
+{
+    free(h);
+}
+
+int mmheap_offer(mmheap_t ** hp, void *item)
+{
+    mmheap_t *h = *hp;
+
+    if (h->count == h->size)
+    {
+        size_t size = h->size * 2;
+
+        if (__max_size() <= h->size)
+            return -1;
+        if (size < h->size || __max_size() < size)
+            size = __max_size();
+
+        if (!(h = realloc(h, __sizeof(size))))
+            return -1;
+        h->size = size;
+        *hp = h;
+    }
+
+    h->array[h->count] = item;
+    __pushup(h, h->count++);
+    return 0;
+}
+
+/**
+ * @return index of the item with the lowest priority */
+static size_t __min_idx(const mmheap_t * h)
+{
+    if (h->count < 3)
+        return h->count - 1;
+
+    return __before(h, 1, 2, 0) ? 1 : 2;
+}
+
+static void *__remove(mmheap_t * h, size_t idx)
+{
+    void *item = h->array[idx];
+
+    h->count--;
+    if (idx < h->count)
+    {
+        h->array[idx] = h->array[h->count];
+        __pushdown(h, idx);
+    }
+
+    return item;
+}
+
+void *mmheap_poll_max(mmheap_t * h)
+{
+    if (0 == h->count)
+        return NULL;
+
+    return __remove(h, 0);
+}
+
+void *mmheap_poll_min(mmheap_t * h)
+{
+    if (0 == h->count)
+        return NULL;
+
+    return __remove(h, __min_idx(h));
+}
+
+void *mmheap_peek_max(const mmheap_t * h)
+{
+    if (0 == h->count)
+        return NULL;
+
+    return h->array[0];
+}
+
+void *mmheap_peek_min(const mmheap_t * h)
+{
+    if (0 == h->count)
+        return NULL;
+
+    return h->array[__min_idx(h)];
+}
+
+void mmheap_clear(mmheap_t * h)
+{
+    h->count = 0;
+}
+
+size_t mmheap_count(const mmheap_t * h)
+{
+    return h->count;
+}
+
+/*--------------------------------------------------------------79-characters-*/
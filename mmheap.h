@@ -0,0 +1,80 @@
+#ifndef MMHEAP_H
+#define MMHEAP_H
+
+#include <stddef.h>
+
+/**
+ * A double-ended (min-max) heap.
+ *
+ * Both the item with the highest priority and the item with the lowest
+ * priority can be peeked in O(1) and polled in O(log n), from a single
+ * contiguous array. Levels alternate between ordering their subtrees
+ * highest first and lowest first.
+ *
+ * Priority uses the same cmp/udata convention as heap_new(). "max" is the
+ * item cmp ranks highest, ie. the one heap_poll() would return; "min" is
+ * the one cmp ranks lowest. */
+typedef struct mmheap_s mmheap_t;
+
+/**
+ * Create new heap and initialise it.
+ *
+ * malloc()s space for heap.
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @return initialised heap */
+mmheap_t *mmheap_new(int (*cmp) (const void *,
+                                 const void *,
+                                 const void *udata),
+                     const void *udata);
+
+/**
+ * NOTE:
+ *  Does not free items. */
+void mmheap_free(mmheap_t * hp);
+
+/**
+ * Add item
+ *
+ * NOTE:
+ *  realloc() possibly called.
+ *  The heap pointer will be changed if the heap needs to be enlarged.
+ *
+ * @param[in/out] hp_ptr Pointer to the heap. Changed when heap is enlarged.
+ * @param[in] item The item to be added
+ * @return 0 on success; -1 on failure, in which case the heap is unchanged */
+int mmheap_offer(mmheap_t ** hp_ptr, void *item);
+
+/**
+ * Remove the item with the highest priority
+ *
+ * @return item; NULL if the heap is empty */
+void *mmheap_poll_max(mmheap_t * hp);
+
+/**
+ * Remove the item with the lowest priority
+ *
+ * @return item; NULL if the heap is empty */
+void *mmheap_poll_min(mmheap_t * hp);
+
+/**
+ * @return item with the highest priority; NULL if the heap is empty */
+void *mmheap_peek_max(const mmheap_t * hp);
+
+/**
+ * @return item with the lowest priority; NULL if the heap is empty */
+void *mmheap_peek_min(const mmheap_t * hp);
+
+/**
+ * Clear all items
+ *
+ * NOTE:
+ *  Does not free items. */
+void mmheap_clear(mmheap_t * hp);
+
+/**
+ * @return number of items in heap */
+size_t mmheap_count(const mmheap_t * hp);
+
+#endif /* MMHEAP_H */
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "heap.h"
+#include "mqueue.h"
+
+#define CACHE_LINE 64
+
+/* busy shards skipped before waiting on one */
+#define LOCK_TRIES 4
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    heap_t *heap;
+} __attribute__((aligned(CACHE_LINE))) shard_t;
+
+struct mqueue_s
+{
+    unsigned int nshards;
+    int (*cmp) (const void *, const void *, const void *);
+    const void *udata;
+    shard_t *shards;
+};
+
+/**
+ * Per thread random number generator; xorshift32 */
+static unsigned int __rand(void)
+{
+    static __thread unsigned int state = 0;
+
+    if (0 == state)
+        state = (unsigned int)(size_t)&state | 1;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+mqueue_t *mqueue_new(int (*cmp) (const void *,
+                                 const void *,
+                                 const void *udata),
+                     const void *udata,
+                     unsigned int nshards)
+{
+    mqueue_t *mq;
+    unsigned int ii;
+
+    if (0 == nshards || !(mq = malloc(sizeof(mqueue_t))))
+        return NULL;
+
+    if (0 != posix_memalign((void **)&mq->shards, CACHE_LINE,
+                            nshards * sizeof(shard_t)))
+    {
+        free(mq);
+        return NULL;
+    }
+
+    mq->nshards = nshards;
+    mq->cmp = cmp;
+    mq->udata = udata;
+
+    for (ii = 0; ii < nshards; ii++)
+    {
+        pthread_mutex_init(&mq->shards[ii].lock, NULL);
+        if (!(mq->shards[ii].heap = heap_new(cmp, udata)))
+        {
+            mq->nshards = ii + 1;
+            mqueue_free(mq);
+            return NULL;
+        }
+    }
+
+    return mq;
+}
+
+void mqueue_free(mqueue_t * mq)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < mq->nshards; ii++)
+    {
+        pthread_mutex_destroy(&mq->shards[ii].lock);
+        if (mq->shards[ii].heap)
+            heap_free(mq->shards[ii].heap);
+    }
+
+    free(mq->shards);
+    free(mq);
+}
+
+/**
+ * Lock a random shard, skipping shards that are busy
+ *
+ * Once a few shards in a row have been busy, as with one shard or more
+ * threads than shards, wait on the last one rather than keep spinning.
+ *
+ * @return the locked shard */
+static shard_t *__lock_random(mqueue_t * mq)
+{
+    unsigned int tries;
+
+    for (tries = 1;; tries++)
+    {
+        shard_t *s = &mq->shards[__rand() % mq->nshards];
+
+        if (0 == pthread_mutex_trylock(&s->lock))
+            return s;
+
+        if (LOCK_TRIES <= tries || mq->nshards <= tries)
+        {
+            pthread_mutex_lock(&s->lock);
+            return s;
+        }
+    }
+}
+
+int mqueue_offer(mqueue_t * mq, void *item)
+{
+    shard_t *s = __lock_random(mq);
+    int e = heap_offer(&s->heap, item);
+
+    pthread_mutex_unlock(&s->lock);
+    return e;
+}
+
+/**
+ * Lock every shard in turn and poll the first non-empty one
+ *
+ * Used once random sampling keeps finding empty shards. */
+static void *__poll_any(mqueue_t * mq)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < mq->nshards; ii++)
+    {
+        shard_t *s = &mq->shards[ii];
+        void *item;
+
+        pthread_mutex_lock(&s->lock);
+        item = heap_poll(s->heap);
+        pthread_mutex_unlock(&s->lock);
+
+        if (item)
+            return item;
+    }
+
+    return NULL;
+}
+
+void *mqueue_poll(mqueue_t * mq)
+{
+    unsigned int tries;
+
+    for (tries = 0; tries < mq->nshards * 2; tries++)
+    {
+        shard_t *a = __lock_random(mq), *b;
+        void *ta, *tb, *item;
+
+        if (1 == mq->nshards)
+        {
+            item = heap_poll(a->heap);
+            pthread_mutex_unlock(&a->lock);
+            return item;
+        }
+
+        /* the second shard must differ and must not block */
+        do
+            b = &mq->shards[__rand() % mq->nshards];
+        while (b == a);
+
+        if (0 != pthread_mutex_trylock(&b->lock))
+        {
+            item = heap_poll(a->heap);
+            pthread_mutex_unlock(&a->lock);
+            if (item)
+                return item;
+            continue;
+        }
+
+        ta = heap_peek(a->heap);
+        tb = heap_peek(b->heap);
+
+        if (0 == heap_count(a->heap) ||
+            (0 < heap_count(b->heap) && mq->cmp(ta, tb, mq->udata) < 0))
+            item = heap_poll(b->heap);
+        else
+            item = heap_poll(a->heap);
+
+        pthread_mutex_unlock(&b->lock);
+        pthread_mutex_unlock(&a->lock);
+
+        if (item)
+            return item;
+    }
+
+    return __poll_any(mq);
+}
+
+size_t mqueue_count(mqueue_t * mq)
+{
+    unsigned int ii;
+    size_t count = 0;
+
+    for (ii = 0; ii < mq->nshards; ii++)
+    {
+        pthread_mutex_lock(&mq->shards[ii].lock);
+        count += heap_count(mq->shards[ii].heap);
+        pthread_mutex_unlock(&mq->shards[ii].lock);
+    }
+
+    return count;
+}
+
+/*--------------------------------------------------------------79-characters-*/
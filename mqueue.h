@@ -0,0 +1,60 @@
+#ifndef MQUEUE_H
+#define MQUEUE_H
+
+#include <stddef.h>
+
+/**
+ * A concurrent, relaxed priority queue built from several heap_t shards
+ * (a "MultiQueue").
+ *
+ * Offers go to a random shard. Polls look at the top of two random shards
+ * and take the better one. Each shard has its own lock and threads
+ * rarely wait on a busy shard; they pick another, and only wait once a
+ * few in a row were busy. Throughput scales with the number of threads.
+ *
+ * The order is relaxed: a poll does not always return the top item of the
+ * whole queue. With s shards the item returned is, on average, among the
+ * top O(s) items, and the rank error does not grow with the number of
+ * items. Use about 2 to 4 shards per thread. With one shard the queue is
+ * exact. */
+typedef struct mqueue_s mqueue_t;
+
+/**
+ * Create new queue and initialise it.
+ *
+ * malloc()s space for the queue and its shards.
+ *
+ * @param[in] cmp Callback used to get an item's priority; as for heap_new()
+ * @param[in] udata User data passed through to cmp callback
+ * @param[in] nshards Number of heaps to spread items over; >= 1
+ * @return initialised queue; NULL on failure */
+mqueue_t *mqueue_new(int (*cmp) (const void *,
+                                 const void *,
+                                 const void *udata),
+                     const void *udata,
+                     unsigned int nshards);
+
+/**
+ * Free the queue. Must not be used concurrently with other calls. */
+void mqueue_free(mqueue_t * mq);
+
+/**
+ * Add item. Thread-safe.
+ *
+ * @param[in] item The item to be added; can't be NULL
+ * @return 0 on success; -1 on failure */
+int mqueue_offer(mqueue_t * mq, void *item);
+
+/**
+ * Remove an item with a top priority. Thread-safe.
+ *
+ * See the relaxation note above.
+ *
+ * @return an item near the top; NULL if the queue appears empty */
+void *mqueue_poll(mqueue_t * mq);
+
+/**
+ * @return number of items in queue; only a snapshot under concurrency */
+size_t mqueue_count(mqueue_t * mq);
+
+#endif /* MQUEUE_H */
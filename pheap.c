@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pheap.h"
+
+struct pheap_s
+{
+    /* items within heap */
+    size_t count;
+    /**  user data */
+    const void *udata;
+    int (*cmp) (const void *, const void *, const void *);
+    pheap_node_t *root;
+};
+
+pheap_t *pheap_new(int (*cmp) (const void *,
+                               const void *,
+                               const void *udata),
+                   const void *udata)
+{
+    pheap_t *h = malloc(sizeof(pheap_t));
+
+    if (!h)
+        return NULL;
+
+    h->cmp = cmp;
+    h->udata = udata;
+    h->count = 0;
+    h->root = NULL;
+
+    return h;
+}
+
+void pheap_free(pheap_t * h)
+{
+    free(h);
+}
+
+/**
+ * Join two trees; the root that loses becomes the other's first child
+ *
+ * @return root of the joined tree */
+static pheap_node_t *__link(const pheap_t * h, pheap_node_t * a,
+                            pheap_node_t * b)
+{
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+
+    /* a must be the winner */
+    if (h->cmp(a, b, h->udata) < 0)
+    {
+        pheap_node_t *tmp = a;
+
+        a = b;
+        b = tmp;
+    }
+
+    b->next = a->child;
+    if (a->child)
+        a->child->prev = b;
+    b->prev = a;
+    a->child = b;
+    a->next = a->prev = NULL;
+
+    return a;
+}
+
+/**
+ * Detach a node, and its subtree, from its parent or siblings */
+static void __cut(pheap_node_t * node)
+{
+    if (node->prev->child == node)
+        node->prev->child = node->next;
+    else
+        node->prev->next = node->next;
+
+    if (node->next)
+        node->next->prev = node->prev;
+
+    node->next = node->prev = NULL;
+}
+
+/**
+ * Two-pass pairing of a sibling list: pair up left to right, then
+ * link the pairs right to left
+ *
+ * @return root of the merged tree */
+static pheap_node_t *__merge_pairs(const pheap_t * h, pheap_node_t * first)
+{
+    pheap_node_t *pairs = NULL, *root = NULL;
+
+    /* first pass; pairs are pushed onto a stack threaded through next */
+    while (first)
+    {
+        pheap_node_t *a = first, *b = first->next, *pair;
+
+        first = b ? b->next : NULL;
+        a->next = a->prev = NULL;
+        if (b)
+            b->next = b->prev = NULL;
+
+        pair = __link(h, a, b);
+        pair->next = pairs;
+        pairs = pair;
+    }
+
+    /* second pass */
+    while (pairs)
+    {
+        pheap_node_t *next = pairs->next;
+
+        pairs->next = NULL;
+        root = __link(h, root, pairs);
+        pairs = next;
+    }
+
+    return root;
+}
+
+void pheap_offer(pheap_t * h, pheap_node_t * node)
+{
+    node->child = node->next = node->prev = NULL;
+    h->root = __link(h, h->root, node);
+    h->count++;
+}
+
+pheap_node_t *pheap_poll(pheap_t * h)
+{
+    pheap_node_t *top = h->root;
+
+    if (!top)
+        return NULL;
+
+    h->root = __merge_pairs(h, top->child);
+    top->child = NULL;
+    h->count--;
+
+    return top;
+}
+
+pheap_node_t *pheap_peek(const pheap_t * h)
+{
+    return h->root;
+}
+
+void pheap_remove_item(pheap_t * h, pheap_node_t * node)
+{
+    pheap_node_t *subtree;
+
+    if (node == h->root)
+    {
+        pheap_poll(h);
+        return;
+    }
+
+    __cut(node);
+    subtree = __merge_pairs(h, node->child);
+    node->child = NULL;
+    h->root = __link(h, h->root, subtree);
+    h->count--;
+}
+
+void pheap_decrease_key(pheap_t * h, pheap_node_t * node)
+{
+    if (node == h->root)
+        return;
+
+    __cut(node);
+    h->root = __link(h, h->root, node);
+}
+
+void pheap_meld(pheap_t * dst, pheap_t * src)
+{
+    dst->root = __link(dst, dst->root, src->root);
+    dst->count += src->count;
+    src->root = NULL;
+    src->count = 0;
+}
+
+void pheap_clear(pheap_t * h)
+{
+    h->root = NULL;
+    h->count = 0;
+}
+
+size_t pheap_count(const pheap_t * h)
+{
+    return h->count;
+}
+
+/*--------------------------------------------------------------79-characters-*/
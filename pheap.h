@@ -0,0 +1,95 @@
+#ifndef PHEAP_H
+#define PHEAP_H
+
+#include <stddef.h>
+
+/**
+ * An intrusive pairing heap.
+ *
+ * Each item embeds a pheap_node_t, so the heap never allocates. Offer,
+ * meld and decrease-key are O(1); poll and remove are amortised
+ * O(log n).
+ *
+ * Priority uses the same cmp/udata convention as heap_new(): the item
+ * that cmp ranks highest is at the top. cmp is given pointers to the
+ * embedded nodes; use container_of-style arithmetic to reach your item. */
+typedef struct pheap_s pheap_t;
+
+/**
+ * A node. Embed it in your own struct; treat the fields as private. */
+typedef struct pheap_node_s
+{
+    struct pheap_node_s *child;
+    /* next sibling */
+    struct pheap_node_s *next;
+    /* previous sibling; or parent if this is the first child */
+    struct pheap_node_s *prev;
+} pheap_node_t;
+
+/**
+ * Create new heap and initialise it.
+ *
+ * malloc()s space for heap.
+ *
+ * @param[in] cmp Callback used to get an item's priority
+ * @param[in] udata User data passed through to cmp callback
+ * @return initialised heap */
+pheap_t *pheap_new(int (*cmp) (const void *,
+                               const void *,
+                               const void *udata),
+                   const void *udata);
+
+/**
+ * NOTE:
+ *  Does not free items. */
+void pheap_free(pheap_t * hp);
+
+/**
+ * Add item. O(1)
+ *
+ * @param[in] node The node embedded in the item to be added */
+void pheap_offer(pheap_t * hp, pheap_node_t * node);
+
+/**
+ * Remove the item with the top priority
+ *
+ * @return top item's node; NULL if the heap is empty */
+pheap_node_t *pheap_poll(pheap_t * hp);
+
+/**
+ * @return top item's node of the heap; NULL if the heap is empty */
+pheap_node_t *pheap_peek(const pheap_t * hp);
+
+/**
+ * Remove item
+ *
+ * @param[in] node The node of an item that is in this heap */
+void pheap_remove_item(pheap_t * hp, pheap_node_t * node);
+
+/**
+ * Restore the item's position after its priority has increased. O(1)
+ *
+ * Use pheap_remove_item() followed by pheap_offer() if the priority
+ * decreased.
+ *
+ * @param[in] node The node of an item that is in this heap */
+void pheap_decrease_key(pheap_t * hp, pheap_node_t * node);
+
+/**
+ * Move all of src's items into dst. O(1)
+ *
+ * Both heaps must use the same cmp and udata. src is left empty. */
+void pheap_meld(pheap_t * dst, pheap_t * src);
+
+/**
+ * Clear all items
+ *
+ * NOTE:
+ *  Does not free items. */
+void pheap_clear(pheap_t * hp);
+
+/**
+ * @return number of items in heap */
+size_t pheap_count(const pheap_t * hp);
+
+#endif /* PHEAP_H */
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "radixheap.h"
+
+/* bucket 0 holds keys equal to last; bucket b holds keys whose highest
+ * bit differing from last is bit b - 1 */
+#define NBUCKETS 65
+
+#define DEFAULT_CAPACITY 13
+
+typedef struct
+{
+    uint64_t key;
+    void *item;
+} entry_t;
+
+typedef struct
+{
+    /* size of array */
+    size_t size;
+    /* items within bucket */
+    size_t count;
+    entry_t *array;
+} bucket_t;
+
+struct radixheap_s
+{
+    /* items within heap */
+    size_t count;
+    /* last polled key */
+    uint64_t last;
+    bucket_t buckets[NBUCKETS];
+};
+
+static unsigned int __bucket(const radixheap_t * h, const uint64_t key)
+{
+    if (key == h->last)
+        return 0;
+
+    return 64 - __builtin_clzll(key ^ h->last);
+}
+
+radixheap_t *radixheap_new(void)
+{
+    radixheap_t *h = calloc(1, sizeof(radixheap_t));
+
+    return h;
+}
+
+void radixheap_free(radixheap_t * h)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < NBUCKETS; ii++)
+        free(h->buckets[ii].array);
+    free(h);
+}
+
+/**
+ * Make room for at least size entries
+ *
+ * @return 0 on success; -1 otherwise */
+static int __reserve(bucket_t * b, size_t size)
+{
+    const size_t max_size = SIZE_MAX / sizeof(entry_t);
+    entry_t *array;
+    size_t new_size;
+
+    if (size <= b->size)
+        return 0;
+
+    if (max_size < size)
+        return -1;
+
+    new_size = b->size ? b->size * 2 : DEFAULT_CAPACITY;
+    if (new_size < size || max_size < new_size)
+        new_size = size;
+
+    if (!(array = realloc(b->array, new_size * sizeof(entry_t))))
+        return -1;
+
+    b->array = array;
+    b->size = new_size;
+    return 0;
+}
+
+static int __push(bucket_t * b, uint64_t key, void *item)
+{
+    if (SIZE_MAX == b->count || -1 == __reserve(b, b->count + 1))
+        return -1;
+
+    b->array[b->count].key = key;
+    b->array[b->count].item = item;
+    b->count++;
+    return 0;
+}
+
+int radixheap_offer(radixheap_t * h, uint64_t key, void *item)
+{
+    if (key < h->last)
+        return -1;
+
+    if (-1 == __push(&h->buckets[__bucket(h, key)], key, item))
+        return -1;
+
+    h->count++;
+    return 0;
+}
+
+/**
+ * @return index of the last of the lowest keys within the bucket, which
+ *  is the one that ends up on top of bucket 0 after __redistribute() */
+static size_t __bucket_min(const bucket_t * b)
+{
+    size_t ii, min = 0;
+
+    for (ii = 1; ii < b->count; ii++)
+        if (b->array[ii].key <= b->array[min].key)
+            min = ii;
+
+    return min;
+}
+
+/**
+ * @return index of the first non-empty bucket */
+static unsigned int __first_bucket(const radixheap_t * h)
+{
+    unsigned int ii;
+
+    for (ii = 0; 0 == h->buckets[ii].count; ii++)
+        ;
+
+    return ii;
+}
+
+/**
+ * Refill bucket 0 by making the lowest key the new last key and spreading
+ * the first non-empty bucket over the lower buckets.
+ *
+ * Every item moves to a strictly lower bucket, which bounds the total work
+ * per item by the number of buckets.
+ *
+ * @return 0 on success; -1 if memory couldn't be allocated */
+static int __redistribute(radixheap_t * h)
+{
+    unsigned int first = __first_bucket(h);
+    bucket_t *b = &h->buckets[first];
+    size_t need[NBUCKETS];
+    uint64_t last = h->last;
+    size_t ii;
+
+    /* work out where everything goes before moving anything so that a
+     * failed allocation leaves the heap untouched */
+    memset(need, 0, sizeof(need));
+    h->last = b->array[__bucket_min(b)].key;
+    for (ii = 0; ii < b->count; ii++)
+        need[__bucket(h, b->array[ii].key)]++;
+
+    for (ii = 0; ii < first; ii++)
+        if (-1 == __reserve(&h->buckets[ii], need[ii]))
+        {
+            h->last = last;
+            return -1;
+        }
+
+    for (ii = 0; ii < b->count; ii++)
+        __push(&h->buckets[__bucket(h, b->array[ii].key)],
+               b->array[ii].key, b->array[ii].item);
+
+    b->count = 0;
+    return 0;
+}
+
+void *radixheap_poll(radixheap_t * h, uint64_t *key)
+{
+    bucket_t *b = &h->buckets[0];
+
+    if (0 == h->count)
+        return NULL;
+
+    if (0 == b->count && -1 == __redistribute(h))
+        return NULL;
+
+    h->count--;
+    b->count--;
+
+    if (key)
+        *key = b->array[b->count].key;
+
+    return b->array[b->count].item;
+}
+
+void *radixheap_peek(radixheap_t * h, uint64_t *key)
+{
+    bucket_t *b = &h->buckets[0];
+    size_t min;
+
+    if (0 == h->count)
+        return NULL;
+
+    /* the top of bucket 0 is what radixheap_poll() takes next. Refill it
+     * as a poll would, so that peeking again is O(1); if that fails, find
+     * the same item the poll will */
+    if (0 < b->count || 0 == __redistribute(h))
+        min = b->count - 1;
+    else
+    {
+        b = &h->buckets[__first_bucket(h)];
+        min = __bucket_min(b);
+    }
+
+    if (key)
+        *key = b->array[min].key;
+
+    return b->array[min].item;
+}
+
+void radixheap_clear(radixheap_t * h)
+{
+    unsigned int ii;
+
+    for (ii = 0; ii < NBUCKETS; ii++)
+        h->buckets[ii].count = 0;
+    h->count = 0;
+}
+
+size_t radixheap_count(const radixheap_t * h)
+{
+    return h->count;
+}
+
+uint64_t radixheap_last(const radixheap_t * h)
+{
+    return h->last;
+}
+
+/*--------------------------------------------------------------79-characters-*/
@@ -0,0 +1,74 @@
+#ifndef RADIXHEAP_H
+#define RADIXHEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A monotone priority queue for unsigned integer keys (a radix heap).
+ *
+ * Items are kept in buckets indexed by the highest bit in which their key
+ * differs from the last polled key. There is no comparator callback.
+ * Offers are O(1) and polls are amortised O(log C), where C is the largest
+ * key span.
+ *
+ * The queue is monotone: a key can't be lower than the key last polled.
+ * This holds for timers and for Dijkstra-style distances. The item with
+ * the lowest key is at the top. */
+typedef struct radixheap_s radixheap_t;
+
+/**
+ * Create new heap and initialise it.
+ *
+ * malloc()s space for heap.
+ *
+ * @return initialised heap */
+radixheap_t *radixheap_new(void);
+
+void radixheap_free(radixheap_t * hp);
+
+/**
+ * Add item
+ *
+ * NOTE:
+ *  realloc() possibly called for the item's bucket. The heap itself does
+ *  not move.
+ *
+ * @param[in] key The item's priority; lower keys are polled first. Can't
+ *  be lower than the last polled key.
+ * @param[in] item The item to be added
+ * @return 0 on success; -1 on failure or if key is below the last polled
+ *  key */
+int radixheap_offer(radixheap_t * hp, uint64_t key, void *item);
+
+/**
+ * Remove the item with the lowest key
+ *
+ * @param[out] key Set to the item's key; may be NULL
+ * @return top item; NULL if the heap is empty */
+void *radixheap_poll(radixheap_t * hp, uint64_t *key);
+
+/**
+ * The item returned is the one radixheap_poll() removes next, even among
+ * equal keys. May move items between buckets, as a poll would.
+ *
+ * @param[out] key Set to the top item's key; may be NULL
+ * @return top item of the heap; NULL if the heap is empty */
+void *radixheap_peek(radixheap_t * hp, uint64_t *key);
+
+/**
+ * Clear all items. The last polled key is kept.
+ *
+ * NOTE:
+ *  Does not free items. */
+void radixheap_clear(radixheap_t * hp);
+
+/**
+ * @return number of items in heap */
+size_t radixheap_count(const radixheap_t * hp);
+
+/**
+ * @return the last polled key, below which no key can be offered */
+uint64_t radixheap_last(const radixheap_t * hp);
+
+#endif /* RADIXHEAP_H */
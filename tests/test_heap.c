@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include "CuTest.h"
 
 #include "heap.h"
@@ -274,3 +275,1196 @@ void TestHeap_offerx_fails_if_not_enough_capacity(
     CuAssertTrue(tc, 2 == heap_count(hp));
     CuAssertTrue(tc, 0 == heap_contains_item(hp, &vals[2]));
 }
+
+typedef struct
+{
+    int val;
+    size_t idx;
+} tracked_t;
+
+static int __tracked_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const tracked_t *t1 = e1;
+
+    const tracked_t *t2 = e2;
+
+    return t2->val - t1->val;
+}
+
+void TestHeap_tracked_remove_item_uses_identity_not_cmp(
+    CuTest * tc
+    )
+{
+    tracked_t vals[4] = { { 5, 0 }, { 5, 0 }, { 1, 0 }, { 3, 0 } };
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+    CuAssertTrue(tc, 0 == heap_set_item_idx_offset(hp, offsetof(tracked_t, idx)));
+
+    for (ii = 0; ii < 4; ii++)
+        heap_offer(&hp, &vals[ii]);
+
+    CuAssertTrue(tc, &vals[1] == heap_remove_item(hp, &vals[1]));
+    CuAssertTrue(tc, 0 == heap_contains_item(hp, &vals[1]));
+    CuAssertTrue(tc, 1 == heap_contains_item(hp, &vals[0]));
+    CuAssertTrue(tc, NULL == heap_remove_item(hp, &vals[1]));
+    CuAssertTrue(tc, 3 == heap_count(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_tracked_remove_item_keeps_heap_property(
+    CuTest * tc
+    )
+{
+    tracked_t vals[7] = { { 1, 0 }, { 10, 0 }, { 2, 0 }, { 11, 0 },
+                          { 12, 0 }, { 3, 0 }, { 4, 0 } };
+    int expected[6] = { 1, 2, 3, 4, 11, 12 };
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+
+    for (ii = 0; ii < 7; ii++)
+        heap_offer(&hp, &vals[ii]);
+
+    /* the last item has to be pushed down, not up, to fill the hole */
+    heap_remove_item(hp, &vals[1]);
+
+    for (ii = 0; ii < 6; ii++)
+        CuAssertTrue(tc, expected[ii] == ((tracked_t*)heap_poll(hp))->val);
+
+    heap_free(hp);
+}
+
+void TestHeap_update_item_reprioritises(
+    CuTest * tc
+    )
+{
+    tracked_t vals[5] = { { 5, 0 }, { 4, 0 }, { 3, 0 }, { 2, 0 }, { 1, 0 } };
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+
+    for (ii = 0; ii < 5; ii++)
+        heap_offer(&hp, &vals[ii]);
+
+    vals[0].val = 0;
+    CuAssertTrue(tc, 0 == heap_update_item(hp, &vals[0]));
+    CuAssertTrue(tc, &vals[0] == heap_peek(hp));
+
+    vals[0].val = 9;
+    CuAssertTrue(tc, 0 == heap_update_item(hp, &vals[0]));
+    CuAssertTrue(tc, &vals[4] == heap_peek(hp));
+
+    for (ii = 0; ii < 4; ii++)
+        heap_poll(hp);
+    CuAssertTrue(tc, &vals[0] == heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_set_item_idx_offset_fails_on_nonempty_heap(
+    CuTest * tc
+    )
+{
+    tracked_t val = { 1, 0 };
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    heap_offer(&hp, &val);
+    CuAssertTrue(tc, -1 == heap_set_item_idx_offset(hp, offsetof(tracked_t, idx)));
+
+    heap_free(hp);
+}
+
+void TestHeap_set_arity_rejects_invalid_arity(
+    CuTest * tc
+    )
+{
+    int val = 1;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    CuAssertTrue(tc, 2 == heap_arity(hp));
+    CuAssertTrue(tc, -1 == heap_set_arity(hp, 0));
+    CuAssertTrue(tc, -1 == heap_set_arity(hp, 1));
+    CuAssertTrue(tc, -1 == heap_set_arity(hp, 3));
+    CuAssertTrue(tc, 0 == heap_set_arity(hp, 8));
+    CuAssertTrue(tc, 8 == heap_arity(hp));
+
+    heap_offer(&hp, &val);
+    CuAssertTrue(tc, -1 == heap_set_arity(hp, 4));
+
+    heap_free(hp);
+}
+
+void TestHeap_dary_poll_removes_best_item(
+    CuTest * tc
+    )
+{
+    unsigned int arities[3] = { 4, 8, 16 };
+    int vals[100];
+    int ii, jj;
+
+    for (ii = 0; ii < 100; ii++)
+        vals[ii] = (ii * 37) % 100;
+
+    for (jj = 0; jj < 3; jj++)
+    {
+        heap_t *hp = heap_new(__uint_compare, NULL);
+
+        heap_set_arity(hp, arities[jj]);
+
+        for (ii = 0; ii < 100; ii++)
+            heap_offer(&hp, &vals[ii]);
+
+        for (ii = 0; ii < 100; ii++)
+            CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+        heap_free(hp);
+    }
+}
+
+void TestHeap_new_from_array_polls_in_order(
+    CuTest * tc
+    )
+{
+    int vals[100];
+    void *items[100];
+    int ii;
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = (ii * 37) % 100;
+        items[ii] = &vals[ii];
+    }
+
+    heap_t *hp = heap_new_from_array(__uint_compare, NULL, items, 100);
+
+    CuAssertTrue(tc, 100 == heap_count(hp));
+    CuAssertTrue(tc, 100 == heap_size(hp));
+
+    for (ii = 0; ii < 100; ii++)
+        CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_many_merges_batches(
+    CuTest * tc
+    )
+{
+    int vals[200];
+    void *items[200];
+    int ii;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+    heap_set_arity(hp, 4);
+
+    for (ii = 0; ii < 200; ii++)
+    {
+        vals[ii] = (ii * 37) % 200;
+        items[ii] = &vals[ii];
+    }
+
+    /* one large batch gets heapified, one small batch gets sifted */
+    CuAssertTrue(tc, 0 == heap_offer_many(&hp, items, 190));
+    CuAssertTrue(tc, 0 == heap_offer_many(&hp, items + 190, 10));
+    CuAssertTrue(tc, 200 == heap_count(hp));
+
+    for (ii = 0; ii < 200; ii++)
+        CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_many_tracks_item_idx(
+    CuTest * tc
+    )
+{
+    tracked_t vals[20];
+    void *items[20];
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+
+    for (ii = 0; ii < 20; ii++)
+    {
+        vals[ii].val = 20 - ii;
+        items[ii] = &vals[ii];
+    }
+
+    heap_offer_many(&hp, items, 20);
+
+    for (ii = 0; ii < 20; ii++)
+        CuAssertTrue(tc, 1 == heap_contains_item(hp, &vals[ii]));
+
+    heap_free(hp);
+}
+
+void TestHeap_poll_n_removes_best_items_in_order(
+    CuTest * tc
+    )
+{
+    int vals[100];
+    void *out[100];
+    int ii;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = (ii * 37) % 100;
+        heap_offer(&hp, &vals[ii]);
+    }
+
+    CuAssertTrue(tc, 40 == heap_poll_n(hp, out, 40));
+    for (ii = 0; ii < 40; ii++)
+        CuAssertTrue(tc, ii == *(int*)out[ii]);
+    CuAssertTrue(tc, 60 == heap_count(hp));
+
+    CuAssertTrue(tc, 60 == heap_poll_n(hp, out, 100));
+    for (ii = 0; ii < 60; ii++)
+        CuAssertTrue(tc, 40 + ii == *(int*)out[ii]);
+    CuAssertTrue(tc, 0 == heap_count(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_poll_until_stops_at_bound(
+    CuTest * tc
+    )
+{
+    int vals[10] = { 9, 2, 5, 7, 4, 6, 3, 8, 1, 0 };
+    int bound = 4;
+    void *out[10];
+    int ii;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    for (ii = 0; ii < 10; ii++)
+        heap_offer(&hp, &vals[ii]);
+
+    CuAssertTrue(tc, 3 == heap_poll_until(hp, out, 3, &bound));
+    CuAssertTrue(tc, 2 == heap_poll_until(hp, out, 10, &bound));
+    CuAssertTrue(tc, 3 == *(int*)out[0]);
+    CuAssertTrue(tc, 4 == *(int*)out[1]);
+    CuAssertTrue(tc, 5 == *(int*)heap_peek(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_stats_count_operations(
+    CuTest * tc
+    )
+{
+    int vals[20];
+    heap_stats_t stats;
+    int ii;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    for (ii = 0; ii < 20; ii++)
+    {
+        vals[ii] = 20 - ii;
+        heap_offer(&hp, &vals[ii]);
+    }
+    heap_poll(hp);
+    heap_remove_item(hp, &vals[0]);
+
+    heap_get_stats(hp, &stats);
+    CuAssertTrue(tc, 20 == stats.offers);
+    CuAssertTrue(tc, 1 == stats.polls);
+    CuAssertTrue(tc, 1 == stats.removes);
+    CuAssertTrue(tc, 1 == stats.grows);
+    CuAssertTrue(tc, 20 == stats.high_water);
+    CuAssertTrue(tc, 0 < stats.comparisons);
+    CuAssertTrue(tc, 0 < stats.swaps);
+    CuAssertTrue(tc, stats.sift_levels >= stats.swaps);
+
+    heap_reset_stats(hp);
+    heap_get_stats(hp, &stats);
+    CuAssertTrue(tc, 0 == stats.offers);
+    CuAssertTrue(tc, 0 == stats.comparisons);
+    CuAssertTrue(tc, 18 == stats.high_water);
+
+    heap_free(hp);
+}
+
+typedef struct
+{
+    int mallocs;
+    int reallocs;
+    int frees;
+    size_t live;
+} __alloc_counts_t;
+
+static void *__counting_malloc(size_t size, void *ctx)
+{
+    __alloc_counts_t *c = ctx;
+
+    c->mallocs++;
+    c->live += size;
+    return malloc(size);
+}
+
+static void *__counting_realloc(void *ptr, size_t old_size, size_t new_size,
+                                void *ctx)
+{
+    __alloc_counts_t *c = ctx;
+
+    c->reallocs++;
+    c->live += new_size - old_size;
+    return realloc(ptr, new_size);
+}
+
+static void __counting_free(void *ptr, size_t size, void *ctx)
+{
+    __alloc_counts_t *c = ctx;
+
+    c->frees++;
+    c->live -= size;
+    free(ptr);
+}
+
+void TestHeap_new_ex_uses_allocator_for_all_memory(
+    CuTest * tc
+    )
+{
+    __alloc_counts_t counts = { 0, 0, 0, 0 };
+    heap_allocator_t alloc = { __counting_malloc, __counting_realloc,
+                               __counting_free, &counts };
+    int vals[100];
+    int ii;
+
+    heap_t *hp = heap_new_ex(__uint_compare, NULL, &alloc);
+
+    CuAssertTrue(tc, 1 == counts.mallocs);
+    CuAssertTrue(tc, heap_sizeof(heap_size(hp)) == counts.live);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = ii;
+        heap_offer(&hp, &vals[ii]);
+    }
+    CuAssertTrue(tc, 0 < counts.reallocs);
+    CuAssertTrue(tc, heap_sizeof(heap_size(hp)) == counts.live);
+
+    heap_free(hp);
+    CuAssertTrue(tc, 1 == counts.frees);
+    CuAssertTrue(tc, 0 == counts.live);
+}
+
+void TestHeap_pushpop_returns_item_if_it_would_be_top(
+    CuTest * tc
+    )
+{
+    int vals[3] = { 5, 3, 8 };
+    int low = 1, high = 4;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    CuAssertTrue(tc, &low == heap_pushpop(hp, &low));
+    CuAssertTrue(tc, 0 == heap_count(hp));
+
+    heap_offer(&hp, &vals[0]);
+    heap_offer(&hp, &vals[1]);
+    heap_offer(&hp, &vals[2]);
+
+    CuAssertTrue(tc, &low == heap_pushpop(hp, &low));
+    CuAssertTrue(tc, &vals[1] == heap_pushpop(hp, &high));
+    CuAssertTrue(tc, 3 == heap_count(hp));
+    CuAssertTrue(tc, 4 == *(int*)heap_poll(hp));
+    CuAssertTrue(tc, 5 == *(int*)heap_poll(hp));
+    CuAssertTrue(tc, 8 == *(int*)heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_replace_returns_top_and_adds_item(
+    CuTest * tc
+    )
+{
+    int vals[3] = { 5, 3, 8 };
+    int low = 1;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    CuAssertTrue(tc, NULL == heap_replace(hp, &low));
+    CuAssertTrue(tc, 0 == heap_count(hp));
+
+    heap_offer(&hp, &vals[0]);
+    heap_offer(&hp, &vals[1]);
+    heap_offer(&hp, &vals[2]);
+
+    CuAssertTrue(tc, &vals[1] == heap_replace(hp, &low));
+    CuAssertTrue(tc, 3 == heap_count(hp));
+    CuAssertTrue(tc, &low == heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_bounded_keeps_best_k(
+    CuTest * tc
+    )
+{
+    int vals[1000];
+    int ii, rejected = 0;
+    void *out;
+
+    heap_t *hp = heap_new_bounded(__uint_compare, NULL, 10);
+
+    for (ii = 0; ii < 1000; ii++)
+    {
+        vals[ii] = (ii * 37) % 1000;
+        out = heap_offer_bounded(hp, &vals[ii]);
+        CuAssertTrue(tc, (ii < 10) == (NULL == out));
+        if (out == &vals[ii])
+            rejected++;
+    }
+
+    CuAssertTrue(tc, 0 < rejected);
+    CuAssertTrue(tc, 10 == heap_count(hp));
+    CuAssertTrue(tc, 10 == heap_size(hp));
+
+    /* the 10 highest values, lowest first */
+    for (ii = 990; ii < 1000; ii++)
+        CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_bounded_keeps_tracked_indices(
+    CuTest * tc
+    )
+{
+    tracked_t items[100];
+    int ii;
+
+    heap_t *hp = heap_new_bounded(__tracked_compare, NULL, 8);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    for (ii = 0; ii < 100; ii++)
+    {
+        items[ii].val = (ii * 37) % 100;
+        heap_offer_bounded(hp, &items[ii]);
+    }
+
+    for (ii = 0; ii < 100; ii++)
+        CuAssertTrue(tc, (92 <= items[ii].val) ==
+                     heap_contains_item(hp, &items[ii]));
+
+    heap_free(hp);
+}
+
+void TestHeap_blocked_layout_polls_in_priority_order(
+    CuTest * tc
+    )
+{
+    unsigned int sizes[3] = { 4, 8, 512 };
+    static int vals[5000];
+    int ii, jj;
+
+    for (jj = 0; jj < 3; jj++)
+    {
+        heap_t *hp = heap_new(__uint_compare, NULL);
+
+        CuAssertTrue(tc, 0 == heap_set_block_size(hp, sizes[jj]));
+        for (ii = 0; ii < 5000; ii++)
+        {
+            vals[ii] = (ii * 3797) % 5000;
+            CuAssertTrue(tc, 0 == heap_offer(&hp, &vals[ii]));
+        }
+        CuAssertTrue(tc, 5000 == heap_count(hp));
+
+        for (ii = 0; ii < 5000; ii++)
+            CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+        CuAssertTrue(tc, NULL == heap_poll(hp));
+
+        heap_free(hp);
+    }
+}
+
+void TestHeap_blocked_layout_supports_tracked_removal(
+    CuTest * tc
+    )
+{
+    static tracked_t items[3000];
+    void *out[64];
+    int ii, prev = -2;
+    size_t got;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    CuAssertTrue(tc, 0 == heap_set_block_size(hp, 8));
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    for (ii = 0; ii < 3000; ii++)
+    {
+        items[ii].val = (ii * 1237) % 3000;
+        heap_offer(&hp, &items[ii]);
+    }
+
+    /* remove every item with an odd value */
+    for (ii = 0; ii < 3000; ii++)
+        if (items[ii].val & 1)
+            CuAssertTrue(tc, &items[ii] == heap_remove_item(hp, &items[ii]));
+    CuAssertTrue(tc, 1500 == heap_count(hp));
+
+    for (ii = 0; ii < 3000; ii++)
+        CuAssertTrue(tc, (0 == (items[ii].val & 1)) ==
+                     heap_contains_item(hp, &items[ii]));
+
+    while (0 < (got = heap_poll_n(hp, out, 64)))
+        for (ii = 0; ii < (int)got; ii++)
+        {
+            CuAssertTrue(tc, prev + 2 == ((tracked_t *)out[ii])->val);
+            prev = ((tracked_t *)out[ii])->val;
+        }
+    CuAssertTrue(tc, 2998 == prev);
+
+    heap_free(hp);
+}
+
+void TestHeap_blocked_layout_offer_many_heapifies(
+    CuTest * tc
+    )
+{
+    static int vals[2000];
+    void *items[2000];
+    int ii;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    heap_set_block_size(hp, 16);
+    for (ii = 0; ii < 2000; ii++)
+    {
+        vals[ii] = (ii * 773) % 2000;
+        items[ii] = &vals[ii];
+    }
+
+    CuAssertTrue(tc, 0 == heap_offer_many(&hp, items, 2000));
+    for (ii = 0; ii < 2000; ii++)
+        CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_set_block_size_rejects_invalid_settings(
+    CuTest * tc
+    )
+{
+    int val = 1;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    CuAssertTrue(tc, -1 == heap_set_block_size(hp, 2));
+    CuAssertTrue(tc, -1 == heap_set_block_size(hp, 12));
+
+    heap_set_arity(hp, 4);
+    CuAssertTrue(tc, -1 == heap_set_block_size(hp, 8));
+    heap_set_arity(hp, 2);
+    CuAssertTrue(tc, 0 == heap_set_block_size(hp, 8));
+    CuAssertTrue(tc, -1 == heap_set_arity(hp, 4));
+
+    heap_offer(&hp, &val);
+    CuAssertTrue(tc, -1 == heap_set_block_size(hp, 0));
+
+    heap_free(hp);
+}
+
+void TestHeap_set_block_size_0_keeps_dary_heap(
+    CuTest * tc
+    )
+{
+    int vals[50];
+    int ii;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    CuAssertTrue(tc, 0 == heap_set_arity(hp, 4));
+    CuAssertTrue(tc, 0 == heap_set_block_size(hp, 0));
+    CuAssertTrue(tc, 4 == heap_arity(hp));
+
+    for (ii = 0; ii < 50; ii++)
+    {
+        vals[ii] = (ii * 37) % 50;
+        heap_offer(&hp, &vals[ii]);
+    }
+    for (ii = 0; ii < 50; ii++)
+        CuAssertTrue(tc, ii == *(int *)heap_poll(hp));
+
+    heap_free(hp);
+}
+
+static void __count_prefetch(const void *item, const void *udata)
+{
+    (void)item;
+    (*(int *)udata)++;
+}
+
+void TestHeap_prefetch_hook_is_called_during_sifts(
+    CuTest * tc
+    )
+{
+    /* big enough to get past the small heap cut off */
+    static int vals[20000];
+    int calls = 0;
+    int ii;
+
+    heap_t *hp = heap_new(__uint_compare, &calls);
+
+    heap_set_prefetch(hp, __count_prefetch);
+    for (ii = 0; ii < 20000; ii++)
+    {
+        vals[ii] = (ii * 37) % 20000;
+        heap_offer(&hp, &vals[ii]);
+    }
+
+    for (ii = 0; ii < 20000; ii++)
+        CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+    CuAssertTrue(tc, 0 < calls);
+
+    heap_free(hp);
+}
+
+void TestHeap_cancel_fails_without_tracked_index(
+    CuTest * tc
+    )
+{
+    int val = 1;
+
+    heap_t *hp = heap_new(__uint_compare, NULL);
+
+    heap_offer(&hp, &val);
+    CuAssertTrue(tc, -1 == heap_cancel(hp, &val));
+    CuAssertTrue(tc, 1 == heap_count(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_cancelled_items_are_never_peeked_or_polled(
+    CuTest * tc
+    )
+{
+    unsigned int sizes[2] = { 0, 8 };
+    static tracked_t items[2000];
+    int ii, jj;
+
+    for (jj = 0; jj < 2; jj++)
+    {
+        heap_t *hp = heap_new(__tracked_compare, NULL);
+
+        heap_set_block_size(hp, sizes[jj]);
+        heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+        CuAssertTrue(tc, 0 == heap_set_tombstone_ratio(hp, 1));
+        for (ii = 0; ii < 2000; ii++)
+        {
+            items[ii].val = (ii * 1237) % 2000;
+            heap_offer(&hp, &items[ii]);
+        }
+
+        /* cancel every item with an odd value, and the lowest even one */
+        for (ii = 0; ii < 2000; ii++)
+            if (items[ii].val & 1 || 0 == items[ii].val)
+                CuAssertTrue(tc, 0 == heap_cancel(hp, &items[ii]));
+        CuAssertTrue(tc, 999 == heap_count(hp));
+        CuAssertTrue(tc, 0 < heap_count_dead(hp));
+        CuAssertTrue(tc, -1 == heap_cancel(hp, &items[1]));
+        CuAssertTrue(tc, 0 == heap_contains_item(hp, &items[1]));
+
+        for (ii = 2; ii < 2000; ii += 2)
+        {
+            CuAssertTrue(tc, ii == ((tracked_t *)heap_peek(hp))->val);
+            CuAssertTrue(tc, ii == ((tracked_t *)heap_poll(hp))->val);
+        }
+        CuAssertTrue(tc, NULL == heap_peek(hp));
+        CuAssertTrue(tc, 0 == heap_count(hp));
+        CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+        heap_free(hp);
+    }
+}
+
+void TestHeap_cancel_compacts_past_tombstone_ratio(
+    CuTest * tc
+    )
+{
+    static tracked_t items[1000];
+    heap_stats_t stats;
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    CuAssertTrue(tc, -1 == heap_set_tombstone_ratio(hp, 0));
+    CuAssertTrue(tc, -1 == heap_set_tombstone_ratio(hp, 1.5));
+    CuAssertTrue(tc, 0 == heap_set_tombstone_ratio(hp, 0.25));
+    for (ii = 0; ii < 1000; ii++)
+    {
+        items[ii].val = ii;
+        heap_offer(&hp, &items[ii]);
+    }
+
+    heap_reset_stats(hp);
+    for (ii = 1; ii < 999; ii++)
+    {
+        CuAssertTrue(tc, 0 == heap_cancel(hp, &items[ii]));
+        CuAssertTrue(tc, heap_count_dead(hp) * 4 <=
+                     heap_count(hp) + heap_count_dead(hp));
+    }
+    heap_get_stats(hp, &stats);
+    CuAssertTrue(tc, 998 == stats.cancels);
+    CuAssertTrue(tc, 0 < stats.compactions);
+    CuAssertTrue(tc, 2 == heap_count(hp));
+
+    heap_compact(hp);
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+    CuAssertTrue(tc, &items[0] == heap_poll(hp));
+    CuAssertTrue(tc, &items[999] == heap_poll(hp));
+    CuAssertTrue(tc, NULL == heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_revives_cancelled_item(
+    CuTest * tc
+    )
+{
+    tracked_t items[100];
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    heap_set_tombstone_ratio(hp, 1);
+    for (ii = 0; ii < 100; ii++)
+    {
+        items[ii].val = ii;
+        heap_offer(&hp, &items[ii]);
+    }
+
+    CuAssertTrue(tc, 0 == heap_cancel(hp, &items[50]));
+    CuAssertTrue(tc, 1 == heap_count_dead(hp));
+
+    /* reschedule it ahead of everything else */
+    items[50].val = -1;
+    CuAssertTrue(tc, 0 == heap_offer(&hp, &items[50]));
+    CuAssertTrue(tc, 100 == heap_count(hp));
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+    CuAssertTrue(tc, &items[50] == heap_poll(hp));
+    for (ii = 0; ii < 100; ii++)
+        if (ii != 50)
+            CuAssertTrue(tc, &items[ii] == heap_poll(hp));
+    CuAssertTrue(tc, NULL == heap_poll(hp));
+
+    heap_free(hp);
+}
+
+static int __val_divisible(const void *item, const void *udata)
+{
+    return 0 == ((const tracked_t *)item)->val % *(const int *)udata;
+}
+
+static void __count_removed(void *item, const void *udata)
+{
+    (void)udata;
+    ((tracked_t *)item)->idx++;
+}
+
+void TestHeap_remove_if_removes_matching_items(
+    CuTest * tc
+    )
+{
+    /* few matches are removed in place, many cause a rebuild */
+    int divisors[3] = { 500, 7, 2 };
+    static tracked_t items[1000];
+    int ii, jj, prev;
+
+    for (jj = 0; jj < 6; jj++)
+    {
+        int divisor = divisors[jj % 3];
+        heap_t *hp = heap_new(__tracked_compare, NULL);
+
+        if (jj < 3)
+            heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+        for (ii = 0; ii < 1000; ii++)
+        {
+            items[ii].val = (ii * 37) % 1000;
+            heap_offer(&hp, &items[ii]);
+        }
+
+        CuAssertTrue(tc, (size_t)(999 / divisor + 1) ==
+                     heap_remove_if(hp, __val_divisible, &divisor, NULL));
+        CuAssertTrue(tc, (size_t)(1000 - 999 / divisor - 1) ==
+                     heap_count(hp));
+
+        for (prev = -1; 0 < heap_count(hp); prev = ii)
+        {
+            ii = ((tracked_t *)heap_poll(hp))->val;
+            CuAssertTrue(tc, prev < ii);
+            CuAssertTrue(tc, 0 != ii % divisor);
+        }
+
+        heap_free(hp);
+    }
+}
+
+void TestHeap_remove_if_reports_each_item_once(
+    CuTest * tc
+    )
+{
+    static tracked_t items[1000];
+    int divisor = 3;
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    /* the heap leaves idx alone, so it counts the callbacks */
+    for (ii = 0; ii < 1000; ii++)
+    {
+        items[ii].val = (ii * 37) % 1000;
+        items[ii].idx = 0;
+        heap_offer(&hp, &items[ii]);
+    }
+
+    CuAssertTrue(tc, 334 == heap_remove_if(hp, __val_divisible, &divisor,
+                                           __count_removed));
+    CuAssertTrue(tc, 0 == heap_remove_if(hp, __val_divisible, &divisor,
+                                         __count_removed));
+    for (ii = 0; ii < 1000; ii++)
+        CuAssertTrue(tc, (0 == items[ii].val % 3) == items[ii].idx);
+
+    heap_free(hp);
+}
+
+static void __negate(void *item, const void *udata)
+{
+    (void)udata;
+    ((tracked_t *)item)->val = -((tracked_t *)item)->val;
+}
+
+void TestHeap_reprioritise_all_rebuilds_heap(
+    CuTest * tc
+    )
+{
+    tracked_t items[100];
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    for (ii = 0; ii < 100; ii++)
+    {
+        items[ii].val = ii;
+        heap_offer(&hp, &items[ii]);
+    }
+    heap_cancel(hp, &items[50]);
+
+    heap_reprioritise_all(hp, __negate, NULL);
+    CuAssertTrue(tc, 99 == heap_count(hp));
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+    for (ii = 99; ii >= 0; ii--)
+        if (ii != 50)
+            CuAssertTrue(tc, &items[ii] == heap_poll(hp));
+    CuAssertTrue(tc, NULL == heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_update_many_restores_heap(
+    CuTest * tc
+    )
+{
+    /* few changes are sifted, many cause a rebuild */
+    int changes[2] = { 5, 500 };
+    static tracked_t items[1000];
+    void *changed[500];
+    int ii, jj, prev;
+
+    for (jj = 0; jj < 2; jj++)
+    {
+        heap_t *hp = heap_new(__tracked_compare, NULL);
+
+        heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+        for (ii = 0; ii < 1000; ii++)
+        {
+            items[ii].val = ii;
+            heap_offer(&hp, &items[ii]);
+        }
+
+        /* move items both up and down */
+        for (ii = 0; ii < changes[jj]; ii++)
+        {
+            tracked_t *item = &items[(ii * 397) % 1000];
+
+            item->val = item->val < 500 ? item->val + 1000 : -item->val;
+            changed[ii] = item;
+        }
+        heap_update_many(hp, changed, changes[jj]);
+        CuAssertTrue(tc, 1000 == heap_count(hp));
+
+        for (prev = -1000; 0 < heap_count(hp); prev = ii)
+        {
+            ii = ((tracked_t *)heap_poll(hp))->val;
+            CuAssertTrue(tc, prev <= ii);
+        }
+
+        heap_free(hp);
+    }
+}
+
+void TestHeap_offer_buffer_keeps_poll_order(
+    CuTest * tc
+    )
+{
+    /* from merging every offer to merging only on the first poll; the
+     * last two are in the blocked layout */
+    size_t buffers[5] = { 1, 16, 4096, 16, 4096 };
+    static int vals[3000];
+    int ii, jj, min;
+
+    for (jj = 0; jj < 5; jj++)
+    {
+        heap_t *hp = heap_new(__uint_compare, NULL);
+
+        if (3 <= jj)
+            heap_set_block_size(hp, 8);
+        heap_set_offer_buffer(hp, buffers[jj]);
+        for (ii = 0, min = 3000; ii < 3000; ii++)
+        {
+            vals[ii] = (ii * 1237) % 3000;
+            CuAssertTrue(tc, 0 == heap_offer(&hp, &vals[ii]));
+            if (vals[ii] < min)
+                min = vals[ii];
+            CuAssertTrue(tc, min == *(int *)heap_peek(hp));
+            CuAssertTrue(tc, (size_t)ii + 1 == heap_count(hp));
+        }
+
+        for (ii = 0; ii < 3000; ii++)
+            CuAssertTrue(tc, ii == *(int *)heap_poll(hp));
+        CuAssertTrue(tc, NULL == heap_poll(hp));
+
+        heap_free(hp);
+    }
+}
+
+void TestHeap_offer_buffer_is_seen_by_other_calls(
+    CuTest * tc
+    )
+{
+    tracked_t items[10];
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    heap_set_offer_buffer(hp, 100);
+    for (ii = 0; ii < 10; ii++)
+    {
+        items[ii].val = 10 - ii;
+        heap_offer(&hp, &items[ii]);
+    }
+
+    CuAssertTrue(tc, 10 == heap_count(hp));
+    CuAssertTrue(tc, heap_contains_item(hp, &items[3]));
+    CuAssertTrue(tc, &items[3] == heap_remove_item(hp, &items[3]));
+    CuAssertTrue(tc, 0 == heap_contains_item(hp, &items[3]));
+
+    /* back into the buffer, ahead of everything in the heap */
+    items[3].val = 0;
+    heap_offer(&hp, &items[3]);
+    CuAssertTrue(tc, 10 == heap_count(hp));
+    CuAssertTrue(tc, &items[3] == heap_peek(hp));
+
+    /* stopping buffering sifts the buffer in */
+    heap_set_offer_buffer(hp, 0);
+    CuAssertTrue(tc, &items[3] == heap_poll(hp));
+    for (ii = 9; ii >= 0; ii--)
+        if (ii != 3)
+            CuAssertTrue(tc, &items[ii] == heap_poll(hp));
+    CuAssertTrue(tc, NULL == heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_buffer_survives_cancel_and_update(
+    CuTest * tc
+    )
+{
+    tracked_t items[5];
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    for (ii = 0; ii < 5; ii++)
+        items[ii].val = ii + 1;
+    heap_offer(&hp, &items[0]);
+    heap_offer(&hp, &items[1]);
+    heap_offer(&hp, &items[2]);
+    heap_offer(&hp, &items[3]);
+    CuAssertTrue(tc, 0 == heap_cancel(hp, &items[1]));
+
+    heap_set_offer_buffer(hp, 10);
+    heap_offer(&hp, &items[4]);
+
+    /* the top moves down, leaving the cancelled item on top */
+    items[0].val = 100;
+    CuAssertTrue(tc, 0 == heap_update_item(hp, &items[0]));
+    CuAssertTrue(tc, 4 == heap_count(hp));
+    CuAssertTrue(tc, heap_contains_item(hp, &items[4]));
+
+    CuAssertTrue(tc, &items[2] == heap_poll(hp));
+    CuAssertTrue(tc, &items[3] == heap_poll(hp));
+    CuAssertTrue(tc, &items[4] == heap_poll(hp));
+    CuAssertTrue(tc, &items[0] == heap_poll(hp));
+    CuAssertTrue(tc, NULL == heap_poll(hp));
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+    heap_free(hp);
+}
+
+static heap_t *__tracked_heap_with_cancelled(tracked_t *items, int n)
+{
+    int ii;
+
+    heap_t *hp = heap_new(__tracked_compare, NULL);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    heap_set_tombstone_ratio(hp, 1);
+    for (ii = 0; ii < n; ii++)
+    {
+        items[ii].val = ii;
+        heap_offer(&hp, &items[ii]);
+    }
+    return hp;
+}
+
+void TestHeap_pushpop_and_replace_revive_cancelled_items(
+    CuTest * tc
+    )
+{
+    tracked_t items[20];
+    int ii;
+
+    heap_t *hp = __tracked_heap_with_cancelled(items, 20);
+
+    CuAssertTrue(tc, 0 == heap_cancel(hp, &items[10]));
+    CuAssertTrue(tc, 0 == heap_cancel(hp, &items[12]));
+
+    /* ahead of everything, so it comes straight back out */
+    items[10].val = -1;
+    CuAssertTrue(tc, &items[10] == heap_pushpop(hp, &items[10]));
+    CuAssertTrue(tc, 18 == heap_count(hp));
+    CuAssertTrue(tc, 1 == heap_count_dead(hp));
+
+    /* the returned item always comes from the heap */
+    items[12].val = -1;
+    CuAssertTrue(tc, &items[0] == heap_replace(hp, &items[12]));
+    CuAssertTrue(tc, 18 == heap_count(hp));
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+    /* and one that sinks */
+    CuAssertTrue(tc, 0 == heap_cancel(hp, &items[2]));
+    items[2].val = 50;
+    CuAssertTrue(tc, &items[12] == heap_replace(hp, &items[2]));
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+    for (ii = 1; ii < 20; ii++)
+        if (ii != 2 && ii != 10 && ii != 12)
+            CuAssertTrue(tc, &items[ii] == heap_poll(hp));
+    CuAssertTrue(tc, &items[2] == heap_poll(hp));
+    CuAssertTrue(tc, NULL == heap_poll(hp));
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_bounded_revives_cancelled_item(
+    CuTest * tc
+    )
+{
+    tracked_t items[8];
+    int ii;
+
+    heap_t *hp = heap_new_bounded(__tracked_compare, NULL, 8);
+
+    heap_set_item_idx_offset(hp, offsetof(tracked_t, idx));
+    heap_set_tombstone_ratio(hp, 1);
+    for (ii = 0; ii < 6; ii++)
+    {
+        items[ii].val = ii;
+        CuAssertTrue(tc, NULL == heap_offer_bounded(hp, &items[ii]));
+    }
+
+    /* with room */
+    CuAssertTrue(tc, 0 == heap_cancel(hp, &items[3]));
+    CuAssertTrue(tc, NULL == heap_offer_bounded(hp, &items[3]));
+    CuAssertTrue(tc, 6 == heap_count(hp));
+
+    /* when full */
+    items[6].val = 6;
+    items[7].val = 7;
+    heap_offer_bounded(hp, &items[6]);
+    heap_offer_bounded(hp, &items[7]);
+    CuAssertTrue(tc, 0 == heap_cancel(hp, &items[4]));
+    CuAssertTrue(tc, NULL == heap_offer_bounded(hp, &items[4]));
+    CuAssertTrue(tc, 8 == heap_count(hp));
+    CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+    for (ii = 0; ii < 8; ii++)
+        CuAssertTrue(tc, &items[ii] == heap_poll(hp));
+    CuAssertTrue(tc, NULL == heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeap_offer_many_revives_rekeyed_cancelled_items(
+    CuTest * tc
+    )
+{
+    /* small batches are sifted, big ones heapified */
+    int batches[2] = { 2, 40 };
+    static tracked_t items[1000];
+    tracked_t extra[40];
+    void *batch[80];
+    int ii, jj, prev;
+
+    for (jj = 0; jj < 2; jj++)
+    {
+        int n = batches[jj];
+        heap_t *hp = __tracked_heap_with_cancelled(items, 1000);
+
+        for (ii = 0; ii < n; ii++)
+        {
+            tracked_t *item = &items[(ii * 397 + 1) % 1000];
+
+            CuAssertTrue(tc, 0 == heap_cancel(hp, item));
+            /* some rise, some sink */
+            item->val = ii & 1 ? -item->val : item->val + 1000;
+            extra[ii].val = ii * 7;
+            batch[ii * 2] = item;
+            batch[ii * 2 + 1] = &extra[ii];
+        }
+        CuAssertTrue(tc, 0 == heap_offer_many(&hp, batch, n * 2));
+        CuAssertTrue(tc, (size_t)(1000 + n) == heap_count(hp));
+        CuAssertTrue(tc, 0 == heap_count_dead(hp));
+
+        for (prev = -1000; 0 < heap_count(hp); prev = ii)
+        {
+            ii = ((tracked_t *)heap_poll(hp))->val;
+            CuAssertTrue(tc, prev <= ii);
+        }
+
+        heap_free(hp);
+    }
+}
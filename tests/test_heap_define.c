@@ -0,0 +1,83 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "CuTest.h"
+
+#include "heap_define.h"
+
+#define int_less(a, b) ((a) < (b))
+HEAP_DEFINE(intheap, int, int_less)
+
+void TestHeapDefine_init_results_in_empty_heap(
+    CuTest * tc
+    )
+{
+    intheap_t h;
+    int val;
+
+    intheap_init(&h);
+
+    CuAssertTrue(tc, 0 == intheap_count(&h));
+    CuAssertTrue(tc, -1 == intheap_peek(&h, &val));
+    CuAssertTrue(tc, -1 == intheap_poll(&h, &val));
+
+    intheap_release(&h);
+}
+
+void TestHeapDefine_poll_removes_best_item(
+    CuTest * tc
+    )
+{
+    intheap_t h;
+    int ii, val;
+
+    intheap_init(&h);
+
+    for (ii = 0; ii < 100; ii++)
+        CuAssertTrue(tc, 0 == intheap_offer(&h, (ii * 37) % 100));
+    CuAssertTrue(tc, 100 == intheap_count(&h));
+
+    CuAssertTrue(tc, 0 == intheap_peek(&h, &val));
+    CuAssertTrue(tc, 0 == val);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        CuAssertTrue(tc, 0 == intheap_poll(&h, &val));
+        CuAssertTrue(tc, ii == val);
+    }
+    CuAssertTrue(tc, 0 == intheap_count(&h));
+
+    intheap_release(&h);
+}
+
+void TestHeapDefine_remove_item_keeps_heap_property(
+    CuTest * tc
+    )
+{
+    int vals[7] = { 1, 10, 2, 11, 12, 3, 4 };
+    int expected[6] = { 1, 2, 3, 4, 11, 12 };
+    intheap_t h;
+    int ii, val;
+
+    intheap_init(&h);
+
+    for (ii = 0; ii < 7; ii++)
+        intheap_offer(&h, vals[ii]);
+
+    CuAssertTrue(tc, 0 == intheap_remove_item(&h, 10, &val));
+    CuAssertTrue(tc, 10 == val);
+    CuAssertTrue(tc, -1 == intheap_remove_item(&h, 10, NULL));
+    CuAssertTrue(tc, 0 == intheap_contains_item(&h, 10));
+    CuAssertTrue(tc, 1 == intheap_contains_item(&h, 12));
+
+    for (ii = 0; ii < 6; ii++)
+    {
+        intheap_poll(&h, &val);
+        CuAssertTrue(tc, expected[ii] == val);
+    }
+
+    intheap_release(&h);
+}
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+
+extern "C" {
+#include "CuTest.h"
+}
+
+#include "heap.hpp"
+
+/**
+ * Ranks keys by their distance from a pivot given at construction */
+struct __closest_to
+{
+    explicit __closest_to(int pivot) : pivot(pivot) {}
+
+    bool operator()(int a, int b) const
+    {
+        return abs(a - pivot) < abs(b - pivot);
+    }
+
+    int pivot;
+};
+
+extern "C" {
+
+void TestHeapHpp_new_heap_is_empty(
+    CuTest * tc
+    )
+{
+    heap::heap<int> h;
+    int val = 7;
+
+    CuAssertTrue(tc, 0 == h.count());
+    CuAssertTrue(tc, !h.peek(val));
+    CuAssertTrue(tc, !h.poll(val));
+    CuAssertTrue(tc, 7 == val);
+}
+
+void TestHeapHpp_poll_removes_best_item(
+    CuTest * tc
+    )
+{
+    heap::heap<int> h;
+    int ii, val;
+
+    for (ii = 0; ii < 100; ii++)
+        h.offer((ii * 37) % 100);
+    CuAssertTrue(tc, 100 == h.count());
+    CuAssertTrue(tc, 100 <= h.size());
+
+    CuAssertTrue(tc, h.peek(val));
+    CuAssertTrue(tc, 0 == val);
+    CuAssertTrue(tc, 100 == h.count());
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        CuAssertTrue(tc, h.poll(val));
+        CuAssertTrue(tc, ii == val);
+    }
+    CuAssertTrue(tc, 0 == h.count());
+    CuAssertTrue(tc, !h.poll(val));
+}
+
+void TestHeapHpp_comparator_sets_order(
+    CuTest * tc
+    )
+{
+    heap::heap<int, std::greater<int> > max;
+    heap::heap<int, __closest_to> closest(__closest_to(50));
+    int expected[5] = { 50, 45, 60, 30, 90 };
+    int ii, val;
+
+    for (ii = 0; ii < 5; ii++)
+    {
+        max.offer(expected[4 - ii]);
+        closest.offer(expected[4 - ii]);
+    }
+
+    CuAssertTrue(tc, max.peek(val));
+    CuAssertTrue(tc, 90 == val);
+
+    for (ii = 0; ii < 5; ii++)
+    {
+        CuAssertTrue(tc, closest.poll(val));
+        CuAssertTrue(tc, expected[ii] == val);
+    }
+}
+
+void TestHeapHpp_remove_item_keeps_heap_property(
+    CuTest * tc
+    )
+{
+    int vals[7] = { 1, 10, 2, 11, 12, 3, 4 };
+    int expected[6] = { 1, 2, 3, 4, 11, 12 };
+    heap::heap<int> h;
+    int ii, val;
+
+    for (ii = 0; ii < 7; ii++)
+        h.offer(vals[ii]);
+
+    CuAssertTrue(tc, h.remove_item(10));
+    CuAssertTrue(tc, !h.remove_item(10));
+    CuAssertTrue(tc, !h.contains_item(10));
+    CuAssertTrue(tc, h.contains_item(12));
+
+    for (ii = 0; ii < 6; ii++)
+    {
+        h.poll(val);
+        CuAssertTrue(tc, expected[ii] == val);
+    }
+
+    h.offer(5);
+    h.clear();
+    CuAssertTrue(tc, 0 == h.count());
+}
+
+} /* extern "C" */
@@ -0,0 +1,69 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "CuTest.h"
+
+#include "heap.h"
+#include "heap_pool.h"
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const int *i1 = e1;
+
+    const int *i2 = e2;
+
+    return *i2 - *i1;
+}
+
+void TestHeapPool_recycles_freed_heaps(
+    CuTest * tc
+    )
+{
+    heap_pool_t *pool = heap_pool_new();
+    heap_t *a, *b;
+
+    a = heap_new_ex(__uint_compare, NULL, heap_pool_allocator(pool));
+    heap_free(a);
+
+    b = heap_new_ex(__uint_compare, NULL, heap_pool_allocator(pool));
+    CuAssertTrue(tc, a == b);
+    heap_free(b);
+
+    heap_pool_free(pool);
+}
+
+void TestHeapPool_grown_heaps_keep_items(
+    CuTest * tc
+    )
+{
+    heap_pool_t *pool = heap_pool_new();
+    int vals[5000];
+    int round, ii;
+
+    /* the second round is served from blocks recycled by the first */
+    for (round = 0; round < 2; round++)
+    {
+        heap_t *hp = heap_new_ex(__uint_compare, NULL,
+                                 heap_pool_allocator(pool));
+
+        for (ii = 0; ii < 5000; ii++)
+        {
+            vals[ii] = (ii * 37) % 5000;
+            heap_offer(&hp, &vals[ii]);
+        }
+
+        for (ii = 0; ii < 5000; ii++)
+            CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+        heap_free(hp);
+    }
+
+    heap_pool_free(pool);
+}
@@ -0,0 +1,156 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "CuTest.h"
+
+#include "heap.h"
+#include "heap_vm.h"
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const int *i1 = e1;
+
+    const int *i2 = e2;
+
+    return *i2 - *i1;
+}
+
+/**
+ * Items are the integers themselves, so that huge heaps need no item
+ * memory */
+static int __uintptr_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    uintptr_t i1 = (uintptr_t)e1, i2 = (uintptr_t)e2;
+
+    return (i2 > i1) - (i2 < i1);
+}
+
+void TestHeapVM_offer_never_moves_heap(
+    CuTest * tc
+    )
+{
+    static int vals[100000];
+    heap_t *hp, *orig;
+    int ii;
+
+    orig = hp = heap_new_reserved(__uint_compare, NULL, 100000);
+    CuAssertTrue(tc, NULL != hp);
+
+    for (ii = 0; ii < 100000; ii++)
+    {
+        vals[ii] = (ii * 37) % 100000;
+        CuAssertTrue(tc, 0 == heap_offer(&hp, &vals[ii]));
+        CuAssertTrue(tc, orig == hp);
+    }
+
+    for (ii = 0; ii < 100000; ii++)
+        CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+    heap_free(hp);
+}
+
+void TestHeapVM_offer_fails_beyond_reservation(
+    CuTest * tc
+    )
+{
+    int vals[2] = { 1, 2 };
+    heap_t *hp, *orig;
+    size_t ii;
+
+    /* reservations are rounded up to whole pages */
+    orig = hp = heap_new_reserved(__uint_compare, NULL, 1);
+
+    for (ii = 0; 0 == heap_offer(&hp, &vals[ii % 2]); ii++)
+        ;
+
+    CuAssertTrue(tc, orig == hp);
+    CuAssertTrue(tc, ii == heap_count(hp));
+    CuAssertTrue(tc, 1 == *(int*)heap_peek(hp));
+
+    heap_free(hp);
+}
+
+void TestHeapVM_huge_pages_fall_back_to_normal_pages(
+    CuTest * tc
+    )
+{
+    int flags[3] = { HEAP_VM_HUGEPAGES, HEAP_VM_HUGETLB,
+                     HEAP_VM_HUGEPAGES | HEAP_VM_HUGETLB };
+    static int vals[10000];
+    heap_t *hp, *orig;
+    int ii, jj;
+
+    for (jj = 0; jj < 3; jj++)
+    {
+        orig = hp = heap_new_reserved_ex(__uint_compare, NULL, 10000,
+                                         flags[jj]);
+        CuAssertTrue(tc, NULL != hp);
+
+        for (ii = 0; ii < 10000; ii++)
+        {
+            vals[ii] = 9999 - ii;
+            CuAssertTrue(tc, 0 == heap_offer(&hp, &vals[ii]));
+        }
+
+        CuAssertTrue(tc, orig == hp);
+        for (ii = 0; ii < 10000; ii++)
+            CuAssertTrue(tc, ii == *(int*)heap_poll(hp));
+
+        heap_free(hp);
+    }
+}
+
+void TestHeapVM_reservation_too_big_fails(
+    CuTest * tc
+    )
+{
+    CuAssertTrue(tc, NULL == heap_new_reserved(__uint_compare, NULL,
+                                               SIZE_MAX / sizeof(void *)));
+}
+
+/**
+ * Sift indices beyond 2^32. Needs over 32GB of memory, so only runs when
+ * HEAP_TEST_BIG is set in the environment. */
+void TestHeapVM_offer_and_poll_beyond_4g_items(
+    CuTest * tc
+    )
+{
+    size_t n = ((size_t)1 << 32) + 1000;
+    uintptr_t ii;
+    heap_t *hp;
+
+    if (sizeof(size_t) < 8 || !getenv("HEAP_TEST_BIG"))
+        return;
+
+    hp = heap_new_reserved_ex(__uintptr_compare, NULL, n + 10,
+                              HEAP_VM_HUGEPAGES);
+    CuAssertTrue(tc, NULL != hp);
+
+    /* increasing keys stay where they are offered */
+    for (ii = 0; ii < n; ii++)
+        CuAssertTrue(tc, 0 == heap_offer(&hp, (void *)(ii + 100)));
+    CuAssertTrue(tc, n == heap_count(hp));
+
+    /* these start past index 2^32 and sift all the way up */
+    for (ii = 10; 0 < ii; ii--)
+        CuAssertTrue(tc, 0 == heap_offer(&hp, (void *)ii));
+
+    for (ii = 1; ii <= 10; ii++)
+        CuAssertTrue(tc, ii == (uintptr_t)heap_poll(hp));
+    for (ii = 100; ii < 1100; ii++)
+        CuAssertTrue(tc, ii == (uintptr_t)heap_poll(hp));
+
+    heap_free(hp);
+}
@@ -0,0 +1,245 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "CuTest.h"
+
+#include "kheap.h"
+
+void TestKHeap_new_results_in_empty_heap(
+    CuTest * tc
+    )
+{
+    kheap_t *hp = kheap_new();
+
+    CuAssertTrue(tc, 0 == kheap_count(hp));
+    CuAssertTrue(tc, NULL == kheap_peek(hp, NULL));
+    CuAssertTrue(tc, NULL == kheap_poll(hp, NULL));
+
+    kheap_free(hp);
+}
+
+void TestKHeap_poll_removes_lowest_key_first(
+    CuTest * tc
+    )
+{
+    int vals[100];
+    int ii;
+
+    kheap_t *hp = kheap_new();
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = (ii * 37) % 100;
+        kheap_offer(&hp, vals[ii], &vals[ii]);
+    }
+    CuAssertTrue(tc, 100 == kheap_count(hp));
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        uint64_t key;
+        int *res = kheap_poll(hp, &key);
+
+        CuAssertTrue(tc, (uint64_t)ii == key);
+        CuAssertTrue(tc, ii == *res);
+    }
+    CuAssertTrue(tc, 0 == kheap_count(hp));
+
+    kheap_free(hp);
+}
+
+void TestKHeap_peek_gets_best_item(
+    CuTest * tc
+    )
+{
+    int vals[3] = { 7, 3, 5 };
+    uint64_t key;
+    int ii;
+
+    kheap_t *hp = kheap_new();
+
+    for (ii = 0; ii < 3; ii++)
+        kheap_offer(&hp, vals[ii], &vals[ii]);
+
+    CuAssertTrue(tc, &vals[1] == kheap_peek(hp, &key));
+    CuAssertTrue(tc, 3 == key);
+    CuAssertTrue(tc, 3 == kheap_count(hp));
+
+    kheap_free(hp);
+}
+
+void TestKHeap_offerx_fails_if_not_enough_capacity(
+    CuTest * tc
+    )
+{
+    kheap_t *hp;
+
+    hp = alloca(kheap_sizeof(2));
+    kheap_init(hp, 2);
+
+    CuAssertTrue(tc, 0 == kheap_offerx(hp, 1, NULL));
+    CuAssertTrue(tc, 0 == kheap_offerx(hp, 2, NULL));
+    CuAssertTrue(tc, -1 == kheap_offerx(hp, 3, NULL));
+    CuAssertTrue(tc, 2 == kheap_count(hp));
+}
+
+void TestKHeap_offer_ensures_capacity_is_sufficient(
+    CuTest * tc
+    )
+{
+    kheap_t *hp;
+
+    hp = malloc(kheap_sizeof(1));
+    kheap_init(hp, 1);
+
+    kheap_offer(&hp, 3, NULL);
+    kheap_offer(&hp, 2, NULL);
+    kheap_offer(&hp, 1, NULL);
+    CuAssertTrue(tc, 4 == kheap_size(hp));
+    CuAssertTrue(tc, 3 == kheap_count(hp));
+
+    kheap_free(hp);
+}
+
+void TestKHeap_signed_and_double_keys_keep_ordering(
+    CuTest * tc
+    )
+{
+    CuAssertTrue(tc, kheap_key_from_int64(-5) < kheap_key_from_int64(-1));
+    CuAssertTrue(tc, kheap_key_from_int64(-1) < kheap_key_from_int64(0));
+    CuAssertTrue(tc, kheap_key_from_int64(0) < kheap_key_from_int64(7));
+    CuAssertTrue(tc, kheap_key_from_double(-2.5) < kheap_key_from_double(-1.0));
+    CuAssertTrue(tc, kheap_key_from_double(-1.0) < kheap_key_from_double(0.0));
+    CuAssertTrue(tc, kheap_key_from_double(0.0) < kheap_key_from_double(0.5));
+    CuAssertTrue(tc, kheap_key_from_double(0.5) < kheap_key_from_double(3.0));
+}
+
+static int __snapshot(kheap_t * hp, char *path)
+{
+    int fd, ret;
+
+    strcpy(path, "/tmp/test_kheap_XXXXXX");
+    if (-1 == (fd = mkstemp(path)))
+        return -1;
+    ret = kheap_save(hp, fd);
+    close(fd);
+    return ret;
+}
+
+void TestKHeap_map_restores_saved_heap(
+    CuTest * tc
+    )
+{
+    char path[32];
+    uint64_t key;
+    uintptr_t ii;
+
+    kheap_t *hp = kheap_new();
+
+    /* items are IDs rather than pointers so the snapshot can be reloaded */
+    for (ii = 0; ii < 1000; ii++)
+        kheap_offer(&hp, (ii * 37) % 1000, (void *)(ii * 37 % 1000 + 1));
+    CuAssertTrue(tc, 0 == __snapshot(hp, path));
+    kheap_free(hp);
+
+    hp = kheap_map(path);
+    CuAssertTrue(tc, NULL != hp);
+    CuAssertTrue(tc, 1000 == kheap_count(hp));
+
+    for (ii = 0; ii < 1000; ii++)
+    {
+        CuAssertTrue(tc, (void *)(ii + 1) == kheap_poll(hp, &key));
+        CuAssertTrue(tc, ii == key);
+    }
+
+    kheap_free(hp);
+    unlink(path);
+}
+
+void TestKHeap_mapped_heap_changes_are_not_written_back(
+    CuTest * tc
+    )
+{
+    char path[32];
+    uint64_t key;
+    int ii;
+
+    kheap_t *hp = kheap_new();
+
+    for (ii = 0; ii < 10; ii++)
+        kheap_offer(&hp, ii, NULL);
+    CuAssertTrue(tc, 0 == __snapshot(hp, path));
+    kheap_free(hp);
+
+    /* polling modifies the mapping in place; offering moves it */
+    hp = kheap_map(path);
+    kheap_poll(hp, NULL);
+    for (ii = 0; ii < 100; ii++)
+        CuAssertTrue(tc, 0 == kheap_offer(&hp, 100 - ii, NULL));
+    CuAssertTrue(tc, 109 == kheap_count(hp));
+    kheap_peek(hp, &key);
+    CuAssertTrue(tc, 1 == key);
+    kheap_free(hp);
+
+    hp = kheap_map(path);
+    CuAssertTrue(tc, 10 == kheap_count(hp));
+    kheap_peek(hp, &key);
+    CuAssertTrue(tc, 0 == key);
+    kheap_free(hp);
+
+    unlink(path);
+}
+
+void TestKHeap_map_of_empty_heap_can_grow(
+    CuTest * tc
+    )
+{
+    char path[32];
+    kheap_t *hp = kheap_new();
+
+    CuAssertTrue(tc, 0 == __snapshot(hp, path));
+    kheap_free(hp);
+
+    hp = kheap_map(path);
+    CuAssertTrue(tc, NULL != hp);
+    CuAssertTrue(tc, 0 == kheap_count(hp));
+    CuAssertTrue(tc, 0 == kheap_offer(&hp, 5, NULL));
+    CuAssertTrue(tc, 1 == kheap_count(hp));
+    kheap_free(hp);
+
+    unlink(path);
+}
+
+void TestKHeap_map_rejects_bad_files(
+    CuTest * tc
+    )
+{
+    char path[32];
+    char junk[200];
+    kheap_t *hp = kheap_new();
+    int fd;
+
+    CuAssertTrue(tc, NULL == kheap_map("/nonexistent/kheap"));
+
+    /* truncated */
+    kheap_offer(&hp, 1, NULL);
+    kheap_offer(&hp, 2, NULL);
+    CuAssertTrue(tc, 0 == __snapshot(hp, path));
+    CuAssertTrue(tc, 0 == truncate(path, 70));
+    CuAssertTrue(tc, NULL == kheap_map(path));
+    unlink(path);
+
+    /* not a snapshot */
+    memset(junk, 'x', sizeof(junk));
+    strcpy(path, "/tmp/test_kheap_XXXXXX");
+    fd = mkstemp(path);
+    CuAssertTrue(tc, (ssize_t)sizeof(junk) == write(fd, junk, sizeof(junk)));
+    close(fd);
+    CuAssertTrue(tc, NULL == kheap_map(path));
+    unlink(path);
+
+    kheap_free(hp);
+}
@@ -0,0 +1,205 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "CuTest.h"
+
+#include "losertree.h"
+
+typedef struct
+{
+    void *vals;
+    size_t width;
+    unsigned int n;
+    unsigned int pos;
+} run_t;
+
+static void *__run_next(void *r)
+{
+    run_t *run = r;
+
+    if (run->pos == run->n)
+        return NULL;
+    return (char *)run->vals + run->width * run->pos++;
+}
+
+static void *__str_run_next(void *r)
+{
+    char **s = __run_next(r);
+
+    return s ? *s : NULL;
+}
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const int *i1 = e1;
+
+    const int *i2 = e2;
+
+    return *i2 - *i1;
+}
+
+void TestLoserTree_merges_runs_in_order(
+    CuTest * tc
+    )
+{
+    static int vals[7][100];
+    run_t runs[7];
+    void *ptrs[7];
+    int ii, jj;
+
+    /* runs of different lengths, interleaved values */
+    for (ii = 0; ii < 7; ii++)
+    {
+        for (jj = 0; jj < 100; jj++)
+            vals[ii][jj] = jj * 7 + ii;
+        runs[ii].vals = vals[ii];
+        runs[ii].width = sizeof(int);
+        runs[ii].n = 100 - ii * 10;
+        runs[ii].pos = 0;
+        ptrs[ii] = &runs[ii];
+    }
+
+    losertree_t *lt = losertree_new(__uint_compare, NULL, __run_next,
+                                    ptrs, 7);
+
+    int prev = -1, count = 0;
+    int *item;
+
+    while ((item = losertree_poll(lt)))
+    {
+        CuAssertTrue(tc, prev < *item);
+        prev = *item;
+        count++;
+    }
+    CuAssertTrue(tc, 100 * 7 - 210 == count);
+    CuAssertTrue(tc, NULL == losertree_peek(lt));
+
+    losertree_free(lt);
+}
+
+void TestLoserTree_ties_come_out_in_run_order(
+    CuTest * tc
+    )
+{
+    int vals[3][2] = { { 1, 2 }, { 1, 2 }, { 1, 2 } };
+    run_t runs[3];
+    void *ptrs[3];
+    void *out[6];
+    int ii;
+
+    for (ii = 0; ii < 3; ii++)
+    {
+        runs[ii].vals = vals[ii];
+        runs[ii].width = sizeof(int);
+        runs[ii].n = 2;
+        runs[ii].pos = 0;
+        ptrs[ii] = &runs[ii];
+    }
+
+    losertree_t *lt = losertree_new(__uint_compare, NULL, __run_next,
+                                    ptrs, 3);
+
+    CuAssertTrue(tc, 6 == losertree_poll_n(lt, out, 6));
+    CuAssertTrue(tc, &vals[0][0] == out[0]);
+    CuAssertTrue(tc, &vals[1][0] == out[1]);
+    CuAssertTrue(tc, &vals[2][0] == out[2]);
+    CuAssertTrue(tc, &vals[0][1] == out[3]);
+    CuAssertTrue(tc, &vals[1][1] == out[4]);
+    CuAssertTrue(tc, &vals[2][1] == out[5]);
+    CuAssertTrue(tc, 0 == losertree_poll_n(lt, out, 6));
+    CuAssertTrue(tc, NULL == losertree_poll(lt));
+
+    losertree_free(lt);
+}
+
+void TestLoserTree_u64_merges_without_callback(
+    CuTest * tc
+    )
+{
+    static uint64_t vals[5][50];
+    run_t runs[5];
+    void *ptrs[5];
+    void *out[64];
+    uint64_t prev = 0;
+    size_t got, total = 0, ii;
+    int jj;
+
+    for (ii = 0; ii < 5; ii++)
+    {
+        for (jj = 0; jj < 50; jj++)
+            vals[ii][jj] = ((uint64_t)jj << 40) + ii;
+        runs[ii].vals = vals[ii];
+        runs[ii].width = sizeof(uint64_t);
+        runs[ii].n = 50;
+        runs[ii].pos = 0;
+        ptrs[ii] = &runs[ii];
+    }
+
+    losertree_t *lt = losertree_new_u64(0, __run_next, ptrs, 5);
+
+    while (0 < (got = losertree_poll_n(lt, out, 64)))
+    {
+        for (ii = 0; ii < got; ii++)
+        {
+            CuAssertTrue(tc, prev <= *(uint64_t *)out[ii]);
+            prev = *(uint64_t *)out[ii];
+        }
+        total += got;
+    }
+    CuAssertTrue(tc, 250 == total);
+
+    losertree_free(lt);
+}
+
+void TestLoserTree_str_merges_in_strcmp_order(
+    CuTest * tc
+    )
+{
+    const char *a[] = { "apple", "fig", "pear" };
+    const char *b[] = { "banana", "cherry", "grape", "plum" };
+    const char *c[] = { "kiwi" };
+    run_t runs[3] = {
+        { a, sizeof(char *), 3, 0 },
+        { b, sizeof(char *), 4, 0 },
+        { c, sizeof(char *), 1, 0 },
+    };
+    void *ptrs[3] = { &runs[0], &runs[1], &runs[2] };
+    const char *expected[] = { "apple", "banana", "cherry", "fig", "grape",
+                               "kiwi", "pear", "plum" };
+    int ii;
+
+    losertree_t *lt = losertree_new_str(__str_run_next, ptrs, 3);
+
+    for (ii = 0; ii < 8; ii++)
+    {
+        const char *s = losertree_poll(lt);
+
+        CuAssertTrue(tc, NULL != s);
+        CuAssertTrue(tc, 0 == strcmp(expected[ii], s));
+    }
+    CuAssertTrue(tc, NULL == losertree_poll(lt));
+
+    losertree_free(lt);
+}
+
+void TestLoserTree_no_runs_is_empty(
+    CuTest * tc
+    )
+{
+    losertree_t *lt = losertree_new(__uint_compare, NULL, __run_next,
+                                    NULL, 0);
+
+    CuAssertTrue(tc, NULL != lt);
+    CuAssertTrue(tc, NULL == losertree_peek(lt));
+    CuAssertTrue(tc, NULL == losertree_poll(lt));
+
+    losertree_free(lt);
+}
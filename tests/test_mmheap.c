@@ -0,0 +1,130 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "CuTest.h"
+
+#include "mmheap.h"
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const int *i1 = e1;
+
+    const int *i2 = e2;
+
+    return *i2 - *i1;
+}
+
+void TestMMHeap_new_results_in_empty_heap(
+    CuTest * tc
+    )
+{
+    mmheap_t *hp = mmheap_new(__uint_compare, NULL);
+
+    CuAssertTrue(tc, 0 == mmheap_count(hp));
+    CuAssertTrue(tc, NULL == mmheap_peek_max(hp));
+    CuAssertTrue(tc, NULL == mmheap_peek_min(hp));
+    CuAssertTrue(tc, NULL == mmheap_poll_max(hp));
+    CuAssertTrue(tc, NULL == mmheap_poll_min(hp));
+
+    mmheap_free(hp);
+}
+
+void TestMMHeap_peek_gets_both_ends(
+    CuTest * tc
+    )
+{
+    int vals[5] = { 5, 1, 9, 3, 7 };
+    int ii;
+
+    mmheap_t *hp = mmheap_new(__uint_compare, NULL);
+
+    for (ii = 0; ii < 5; ii++)
+        mmheap_offer(&hp, &vals[ii]);
+
+    /* highest priority is the lowest value */
+    CuAssertTrue(tc, 1 == *(int*)mmheap_peek_max(hp));
+    CuAssertTrue(tc, 9 == *(int*)mmheap_peek_min(hp));
+    CuAssertTrue(tc, 5 == mmheap_count(hp));
+
+    mmheap_free(hp);
+}
+
+void TestMMHeap_poll_max_gets_items_in_priority_order(
+    CuTest * tc
+    )
+{
+    int vals[100];
+    int ii;
+
+    mmheap_t *hp = mmheap_new(__uint_compare, NULL);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = (ii * 37) % 100;
+        mmheap_offer(&hp, &vals[ii]);
+    }
+
+    for (ii = 0; ii < 100; ii++)
+        CuAssertTrue(tc, ii == *(int*)mmheap_poll_max(hp));
+    CuAssertTrue(tc, 0 == mmheap_count(hp));
+
+    mmheap_free(hp);
+}
+
+void TestMMHeap_poll_min_gets_items_in_reverse_order(
+    CuTest * tc
+    )
+{
+    int vals[100];
+    int ii;
+
+    mmheap_t *hp = mmheap_new(__uint_compare, NULL);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = (ii * 37) % 100;
+        mmheap_offer(&hp, &vals[ii]);
+    }
+
+    for (ii = 99; 0 <= ii; ii--)
+        CuAssertTrue(tc, ii == *(int*)mmheap_poll_min(hp));
+    CuAssertTrue(tc, 0 == mmheap_count(hp));
+
+    mmheap_free(hp);
+}
+
+void TestMMHeap_mixed_polls_drain_from_both_ends(
+    CuTest * tc
+    )
+{
+    int vals[1000];
+    int ii, lo = 0, hi = 999;
+    unsigned int seed = 1;
+
+    mmheap_t *hp = mmheap_new(__uint_compare, NULL);
+
+    for (ii = 0; ii < 1000; ii++)
+    {
+        vals[ii] = (ii * 379) % 1000;
+        mmheap_offer(&hp, &vals[ii]);
+    }
+
+    while (0 < mmheap_count(hp))
+    {
+        seed = seed * 1103515245 + 12345;
+        if (seed & 0x10000)
+            CuAssertTrue(tc, lo++ == *(int*)mmheap_poll_max(hp));
+        else
+            CuAssertTrue(tc, hi-- == *(int*)mmheap_poll_min(hp));
+    }
+    CuAssertTrue(tc, lo == hi + 1);
+
+    mmheap_free(hp);
+}
@@ -0,0 +1,157 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "CuTest.h"
+
+#include "mqueue.h"
+
+static int __uint_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const int *i1 = e1;
+
+    const int *i2 = e2;
+
+    return *i2 - *i1;
+}
+
+void TestMQueue_single_shard_is_exact(
+    CuTest * tc
+    )
+{
+    int vals[100];
+    int ii;
+
+    mqueue_t *mq = mqueue_new(__uint_compare, NULL, 1);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = (ii * 37) % 100;
+        mqueue_offer(mq, &vals[ii]);
+    }
+    CuAssertTrue(tc, 100 == mqueue_count(mq));
+
+    for (ii = 0; ii < 100; ii++)
+        CuAssertTrue(tc, ii == *(int*)mqueue_poll(mq));
+    CuAssertTrue(tc, NULL == mqueue_poll(mq));
+
+    mqueue_free(mq);
+}
+
+void TestMQueue_poll_returns_every_item_once(
+    CuTest * tc
+    )
+{
+    int vals[1000];
+    char seen[1000];
+    int ii;
+
+    mqueue_t *mq = mqueue_new(__uint_compare, NULL, 8);
+
+    memset(seen, 0, sizeof(seen));
+
+    for (ii = 0; ii < 1000; ii++)
+    {
+        vals[ii] = ii;
+        mqueue_offer(mq, &vals[ii]);
+    }
+
+    for (ii = 0; ii < 1000; ii++)
+    {
+        int *res = mqueue_poll(mq);
+
+        CuAssertTrue(tc, NULL != res);
+        CuAssertTrue(tc, 0 == seen[*res]);
+        seen[*res] = 1;
+    }
+    CuAssertTrue(tc, NULL == mqueue_poll(mq));
+    CuAssertTrue(tc, 0 == mqueue_count(mq));
+
+    mqueue_free(mq);
+}
+
+typedef struct
+{
+    mqueue_t *mq;
+    int *vals;
+    int n;
+} __producer_t;
+
+static void *__produce(void *arg)
+{
+    __producer_t *p = arg;
+    int ii;
+
+    for (ii = 0; ii < p->n; ii++)
+        mqueue_offer(p->mq, &p->vals[ii]);
+
+    return NULL;
+}
+
+void TestMQueue_concurrent_offers_are_not_lost(
+    CuTest * tc
+    )
+{
+    static int vals[4][500];
+    __producer_t p[4];
+    pthread_t threads[4];
+    int ii, count = 0;
+
+    mqueue_t *mq = mqueue_new(__uint_compare, NULL, 8);
+
+    for (ii = 0; ii < 4; ii++)
+    {
+        p[ii].mq = mq;
+        p[ii].vals = vals[ii];
+        p[ii].n = 500;
+        pthread_create(&threads[ii], NULL, __produce, &p[ii]);
+    }
+
+    for (ii = 0; ii < 4; ii++)
+        pthread_join(threads[ii], NULL);
+
+    CuAssertTrue(tc, 2000 == mqueue_count(mq));
+    while (mqueue_poll(mq))
+        count++;
+    CuAssertTrue(tc, 2000 == count);
+
+    mqueue_free(mq);
+}
+
+void TestMQueue_concurrent_offers_into_one_shard_are_not_lost(
+    CuTest * tc
+    )
+{
+    static int vals[4][500];
+    __producer_t p[4];
+    pthread_t threads[4];
+    int ii, count = 0;
+
+    /* every thread contends for the same lock */
+    mqueue_t *mq = mqueue_new(__uint_compare, NULL, 1);
+
+    for (ii = 0; ii < 4; ii++)
+    {
+        p[ii].mq = mq;
+        p[ii].vals = vals[ii];
+        p[ii].n = 500;
+        pthread_create(&threads[ii], NULL, __produce, &p[ii]);
+    }
+
+    for (ii = 0; ii < 4; ii++)
+        pthread_join(threads[ii], NULL);
+
+    CuAssertTrue(tc, 2000 == mqueue_count(mq));
+    while (mqueue_poll(mq))
+        count++;
+    CuAssertTrue(tc, 2000 == count);
+
+    mqueue_free(mq);
+}
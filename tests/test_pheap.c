@@ -0,0 +1,133 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "CuTest.h"
+
+#include "pheap.h"
+
+typedef struct
+{
+    int val;
+    pheap_node_t node;
+} pitem_t;
+
+#define PITEM(n) ((pitem_t *)((char *)(n) - offsetof(pitem_t, node)))
+
+static int __pitem_compare(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    return PITEM(e2)->val - PITEM(e1)->val;
+}
+
+void TestPHeap_new_results_in_empty_heap(
+    CuTest * tc
+    )
+{
+    pheap_t *hp = pheap_new(__pitem_compare, NULL);
+
+    CuAssertTrue(tc, 0 == pheap_count(hp));
+    CuAssertTrue(tc, NULL == pheap_peek(hp));
+    CuAssertTrue(tc, NULL == pheap_poll(hp));
+
+    pheap_free(hp);
+}
+
+void TestPHeap_poll_removes_best_item(
+    CuTest * tc
+    )
+{
+    pitem_t items[100];
+    int ii;
+
+    pheap_t *hp = pheap_new(__pitem_compare, NULL);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        items[ii].val = (ii * 37) % 100;
+        pheap_offer(hp, &items[ii].node);
+    }
+    CuAssertTrue(tc, 100 == pheap_count(hp));
+    CuAssertTrue(tc, 0 == PITEM(pheap_peek(hp))->val);
+
+    for (ii = 0; ii < 100; ii++)
+        CuAssertTrue(tc, ii == PITEM(pheap_poll(hp))->val);
+    CuAssertTrue(tc, 0 == pheap_count(hp));
+
+    pheap_free(hp);
+}
+
+void TestPHeap_decrease_key_and_remove_item(
+    CuTest * tc
+    )
+{
+    pitem_t items[100];
+    int ii, last = -1;
+
+    pheap_t *hp = pheap_new(__pitem_compare, NULL);
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        items[ii].val = 1000 + (ii * 37) % 100;
+        pheap_offer(hp, &items[ii].node);
+    }
+
+    /* poll once so that the heap has some structure */
+    pheap_offer(hp, pheap_poll(hp));
+
+    for (ii = 0; ii < 100; ii += 3)
+    {
+        items[ii].val -= 500 + ii;
+        pheap_decrease_key(hp, &items[ii].node);
+    }
+
+    for (ii = 1; ii < 100; ii += 3)
+        pheap_remove_item(hp, &items[ii].node);
+
+    CuAssertTrue(tc, 67 == pheap_count(hp));
+
+    for (ii = 0; ii < 67; ii++)
+    {
+        pitem_t *item = PITEM(pheap_poll(hp));
+
+        CuAssertTrue(tc, last <= item->val);
+        CuAssertTrue(tc, 1 != (item - items) % 3);
+        last = item->val;
+    }
+
+    pheap_free(hp);
+}
+
+void TestPHeap_meld_moves_all_items(
+    CuTest * tc
+    )
+{
+    pitem_t items[20];
+    int ii;
+
+    pheap_t *a = pheap_new(__pitem_compare, NULL);
+    pheap_t *b = pheap_new(__pitem_compare, NULL);
+
+    for (ii = 0; ii < 20; ii++)
+    {
+        items[ii].val = 20 - ii;
+        pheap_offer(ii % 2 ? a : b, &items[ii].node);
+    }
+
+    pheap_meld(a, b);
+    CuAssertTrue(tc, 20 == pheap_count(a));
+    CuAssertTrue(tc, 0 == pheap_count(b));
+    CuAssertTrue(tc, NULL == pheap_peek(b));
+
+    for (ii = 0; ii < 20; ii++)
+        CuAssertTrue(tc, ii + 1 == PITEM(pheap_poll(a))->val);
+
+    pheap_free(a);
+    pheap_free(b);
+}
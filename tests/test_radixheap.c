@@ -0,0 +1,128 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "CuTest.h"
+
+#include "radixheap.h"
+
+void TestRadixHeap_new_results_in_empty_heap(
+    CuTest * tc
+    )
+{
+    radixheap_t *hp = radixheap_new();
+
+    CuAssertTrue(tc, 0 == radixheap_count(hp));
+    CuAssertTrue(tc, NULL == radixheap_peek(hp, NULL));
+    CuAssertTrue(tc, NULL == radixheap_poll(hp, NULL));
+
+    radixheap_free(hp);
+}
+
+void TestRadixHeap_poll_removes_lowest_key_first(
+    CuTest * tc
+    )
+{
+    int vals[100];
+    int ii;
+
+    radixheap_t *hp = radixheap_new();
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        vals[ii] = (ii * 37) % 100;
+        CuAssertTrue(tc, 0 == radixheap_offer(hp, vals[ii], &vals[ii]));
+    }
+    CuAssertTrue(tc, 100 == radixheap_count(hp));
+
+    for (ii = 0; ii < 100; ii++)
+    {
+        uint64_t key, peeked;
+
+        CuAssertTrue(tc, NULL != radixheap_peek(hp, &peeked));
+        CuAssertTrue(tc, ii == *(int*)radixheap_poll(hp, &key));
+        CuAssertTrue(tc, (uint64_t)ii == key);
+        CuAssertTrue(tc, peeked == key);
+    }
+    CuAssertTrue(tc, 0 == radixheap_count(hp));
+
+    radixheap_free(hp);
+}
+
+void TestRadixHeap_offer_rejects_key_below_last_polled(
+    CuTest * tc
+    )
+{
+    radixheap_t *hp = radixheap_new();
+
+    radixheap_offer(hp, 10, NULL);
+    radixheap_offer(hp, 20, NULL);
+    radixheap_poll(hp, NULL);
+
+    CuAssertTrue(tc, 10 == radixheap_last(hp));
+    CuAssertTrue(tc, -1 == radixheap_offer(hp, 9, NULL));
+    CuAssertTrue(tc, 0 == radixheap_offer(hp, 10, NULL));
+    CuAssertTrue(tc, 2 == radixheap_count(hp));
+
+    radixheap_free(hp);
+}
+
+void TestRadixHeap_interleaved_monotone_workload(
+    CuTest * tc
+    )
+{
+    uint64_t key, last = 0;
+    unsigned int seed = 1;
+    int ii;
+
+    radixheap_t *hp = radixheap_new();
+
+    for (ii = 0; ii < 64; ii++)
+        radixheap_offer(hp, ii * 1000003ULL, NULL);
+
+    for (ii = 0; ii < 10000; ii++)
+    {
+        radixheap_poll(hp, &key);
+        CuAssertTrue(tc, last <= key);
+        last = key;
+
+        seed = seed * 1103515245 + 12345;
+        key += (seed >> 8) + ((uint64_t)(seed & 0xff) << 32);
+        CuAssertTrue(tc, 0 == radixheap_offer(hp, key, NULL));
+    }
+    CuAssertTrue(tc, 64 == radixheap_count(hp));
+
+    radixheap_clear(hp);
+    CuAssertTrue(tc, 0 == radixheap_count(hp));
+
+    radixheap_free(hp);
+}
+
+void TestRadixHeap_peek_returns_next_polled_among_ties(
+    CuTest * tc
+    )
+{
+    int vals[8];
+    int ii;
+
+    radixheap_t *hp = radixheap_new();
+
+    /* two runs of ties, one above last and one equal to it */
+    for (ii = 0; ii < 8; ii++)
+        CuAssertTrue(tc, 0 == radixheap_offer(hp, ii < 4 ? 5 : 0, &vals[ii]));
+
+    for (ii = 0; ii < 8; ii++)
+    {
+        uint64_t key, peeked;
+        void *item = radixheap_peek(hp, &peeked);
+
+        CuAssertTrue(tc, item == radixheap_peek(hp, NULL));
+        CuAssertTrue(tc, item == radixheap_poll(hp, &key));
+        CuAssertTrue(tc, peeked == key);
+    }
+    CuAssertTrue(tc, NULL == radixheap_peek(hp, NULL));
+
+    radixheap_free(hp);
+}
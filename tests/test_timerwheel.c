@@ -0,0 +1,173 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "CuTest.h"
+
+#include "timerwheel.h"
+
+void TestTimerWheel_new_results_in_empty_wheel(
+    CuTest * tc
+    )
+{
+    timerwheel_timer_t *out[1];
+
+    timerwheel_t *tw = timerwheel_new(100);
+
+    CuAssertTrue(tc, 0 == timerwheel_count(tw));
+    CuAssertTrue(tc, 0 == timerwheel_poll_expired(tw, 1000, out, 1));
+
+    timerwheel_free(tw);
+}
+
+void TestTimerWheel_timers_expire_in_order(
+    CuTest * tc
+    )
+{
+    /* one per level and one in the overflow heap */
+    uint64_t expires[5] = { 300, 5, 100000000, 2000000, 20000 };
+    uint64_t expected[5] = { 5, 300, 20000, 2000000, 100000000 };
+    timerwheel_timer_t timers[5];
+    timerwheel_timer_t *out[5];
+    int ii;
+
+    timerwheel_t *tw = timerwheel_new(1);
+
+    for (ii = 0; ii < 5; ii++)
+    {
+        timerwheel_timer_init(&timers[ii]);
+        CuAssertTrue(tc, 0 == timerwheel_schedule(tw, &timers[ii], expires[ii]));
+    }
+    CuAssertTrue(tc, 5 == timerwheel_count(tw));
+
+    for (ii = 0; ii < 5; ii++)
+    {
+        CuAssertTrue(tc, 0 == timerwheel_poll_expired(tw, expected[ii] - 1,
+                                                      out, 5));
+        CuAssertTrue(tc, 1 == timerwheel_poll_expired(tw, expected[ii], out, 5));
+        CuAssertTrue(tc, expected[ii] == out[0]->expires);
+        CuAssertTrue(tc, 0 == timerwheel_timer_is_scheduled(out[0]));
+    }
+    CuAssertTrue(tc, 0 == timerwheel_count(tw));
+
+    timerwheel_free(tw);
+}
+
+void TestTimerWheel_timer_in_the_past_fires_on_next_poll(
+    CuTest * tc
+    )
+{
+    timerwheel_timer_t timer;
+    timerwheel_timer_t *out[1];
+
+    timerwheel_t *tw = timerwheel_new(0);
+
+    timerwheel_poll_expired(tw, 1000, out, 1);
+
+    timerwheel_timer_init(&timer);
+    timerwheel_schedule(tw, &timer, 10);
+    CuAssertTrue(tc, 1 == timerwheel_timer_is_scheduled(&timer));
+
+    CuAssertTrue(tc, 1 == timerwheel_poll_expired(tw, 1000, out, 1));
+    CuAssertTrue(tc, &timer == out[0]);
+
+    timerwheel_free(tw);
+}
+
+void TestTimerWheel_cancel_removes_timer(
+    CuTest * tc
+    )
+{
+    timerwheel_timer_t timers[3];
+    timerwheel_timer_t *out[3];
+    int ii;
+
+    timerwheel_t *tw = timerwheel_new(0);
+
+    for (ii = 0; ii < 3; ii++)
+        timerwheel_timer_init(&timers[ii]);
+
+    CuAssertTrue(tc, -1 == timerwheel_cancel(tw, &timers[0]));
+
+    timerwheel_schedule(tw, &timers[0], 10);
+    timerwheel_schedule(tw, &timers[1], 10);
+    timerwheel_schedule(tw, &timers[2], (uint64_t)1 << 40);
+
+    CuAssertTrue(tc, 0 == timerwheel_cancel(tw, &timers[0]));
+    CuAssertTrue(tc, 0 == timerwheel_cancel(tw, &timers[2]));
+    CuAssertTrue(tc, -1 == timerwheel_cancel(tw, &timers[2]));
+    CuAssertTrue(tc, 1 == timerwheel_count(tw));
+
+    CuAssertTrue(tc, 1 == timerwheel_poll_expired(tw, (uint64_t)1 << 41,
+                                                  out, 3));
+    CuAssertTrue(tc, &timers[1] == out[0]);
+
+    timerwheel_free(tw);
+}
+
+void TestTimerWheel_poll_expired_respects_max(
+    CuTest * tc
+    )
+{
+    timerwheel_timer_t timers[10];
+    timerwheel_timer_t *out[4];
+    int ii;
+
+    timerwheel_t *tw = timerwheel_new(0);
+
+    for (ii = 0; ii < 10; ii++)
+    {
+        timerwheel_timer_init(&timers[ii]);
+        timerwheel_schedule(tw, &timers[ii], 50 + ii / 5);
+    }
+
+    CuAssertTrue(tc, 4 == timerwheel_poll_expired(tw, 100, out, 4));
+    CuAssertTrue(tc, 6 == timerwheel_count(tw));
+
+    /* a pending expired timer can still be cancelled */
+    CuAssertTrue(tc, 0 == timerwheel_cancel(tw, &timers[9]));
+
+    CuAssertTrue(tc, 4 == timerwheel_poll_expired(tw, 100, out, 4));
+    CuAssertTrue(tc, 1 == timerwheel_poll_expired(tw, 100, out, 4));
+    CuAssertTrue(tc, 0 == timerwheel_count(tw));
+
+    timerwheel_free(tw);
+}
+
+void TestTimerWheel_random_schedule_matches_sorted_order(
+    CuTest * tc
+    )
+{
+    static timerwheel_timer_t timers[2000];
+    timerwheel_timer_t *out[16];
+    unsigned int seed = 7;
+    uint64_t now = 12345, last = 0;
+    int ii, n, polled = 0;
+
+    timerwheel_t *tw = timerwheel_new(now);
+
+    for (ii = 0; ii < 2000; ii++)
+    {
+        seed = seed * 1103515245 + 12345;
+        timerwheel_timer_init(&timers[ii]);
+        timerwheel_schedule(tw, &timers[ii], now + (seed >> (ii % 24)));
+    }
+
+    while (polled < 2000)
+    {
+        now += 997;
+        while (0 < (n = timerwheel_poll_expired(tw, now, out, 16)))
+            for (ii = 0; ii < n; ii++)
+            {
+                CuAssertTrue(tc, last <= out[ii]->expires);
+                CuAssertTrue(tc, now >= out[ii]->expires);
+                last = out[ii]->expires;
+                polled++;
+            }
+    }
+    CuAssertTrue(tc, 0 == timerwheel_count(tw));
+
+    timerwheel_free(tw);
+}
@@ -0,0 +1,123 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "CuTest.h"
+
+#include "vheap.h"
+
+void TestVHeap_new_rejects_invalid_arity(
+    CuTest * tc
+    )
+{
+    CuAssertTrue(tc, NULL == vheap_new(2));
+    CuAssertTrue(tc, NULL == vheap_new(12));
+}
+
+void TestVHeap_new_results_in_empty_heap(
+    CuTest * tc
+    )
+{
+    vheap_t *hp = vheap_new(8);
+
+    CuAssertTrue(tc, 0 == vheap_count(hp));
+    CuAssertTrue(tc, NULL == vheap_peek(hp, NULL));
+    CuAssertTrue(tc, NULL == vheap_poll(hp, NULL));
+
+    vheap_free(hp);
+}
+
+void TestVHeap_poll_removes_lowest_key_first(
+    CuTest * tc
+    )
+{
+    unsigned int arities[3] = { 4, 8, 16 };
+    int vals[1000];
+    int ii, jj;
+
+    for (jj = 0; jj < 3; jj++)
+    {
+        vheap_t *hp = vheap_new(arities[jj]);
+
+        for (ii = 0; ii < 1000; ii++)
+        {
+            vals[ii] = (ii * 379) % 1000;
+            CuAssertTrue(tc, 0 == vheap_offer(hp, vals[ii], &vals[ii]));
+        }
+        CuAssertTrue(tc, 1000 == vheap_count(hp));
+
+        for (ii = 0; ii < 1000; ii++)
+        {
+            uint32_t key;
+            int *res = vheap_poll(hp, &key);
+
+            CuAssertTrue(tc, (uint32_t)ii == key);
+            CuAssertTrue(tc, ii == *res);
+        }
+        CuAssertTrue(tc, 0 == vheap_count(hp));
+
+        vheap_free(hp);
+    }
+}
+
+void TestVHeap_simd_and_scalar_poll_identically(
+    CuTest * tc
+    )
+{
+    unsigned int arities[3] = { 4, 8, 16 };
+    static int items[5000];
+    unsigned int seed = 7;
+    int ii, jj;
+
+    for (jj = 0; jj < 3; jj++)
+    {
+        vheap_t *a = vheap_new(arities[jj]);
+        vheap_t *b = vheap_new(arities[jj]);
+
+        /* no SIMD on this machine; nothing to compare against */
+        if (-1 == vheap_set_simd(a, 1))
+        {
+            vheap_free(a);
+            vheap_free(b);
+            continue;
+        }
+        CuAssertTrue(tc, 0 == vheap_set_simd(b, 0));
+        CuAssertTrue(tc, vheap_simd(a));
+        CuAssertTrue(tc, !vheap_simd(b));
+
+        /* few distinct keys so that ties are common, plus UINT32_MAX */
+        for (ii = 0; ii < 5000; ii++)
+        {
+            uint32_t key;
+
+            seed = seed * 1103515245 + 12345;
+            key = 0 == ii % 97 ? UINT32_MAX : (seed >> 16) % 50;
+            vheap_offer(a, key, &items[ii]);
+            vheap_offer(b, key, &items[ii]);
+        }
+
+        for (ii = 0; ii < 5000; ii++)
+        {
+            uint32_t ka, kb;
+
+            CuAssertTrue(tc, vheap_poll(a, &ka) == vheap_poll(b, &kb));
+            CuAssertTrue(tc, ka == kb);
+        }
+
+        vheap_free(a);
+        vheap_free(b);
+    }
+}
+
+void TestVHeap_float_keys_keep_ordering(
+    CuTest * tc
+    )
+{
+    CuAssertTrue(tc, vheap_key_from_float(-2.5f) < vheap_key_from_float(-1.0f));
+    CuAssertTrue(tc, vheap_key_from_float(-1.0f) < vheap_key_from_float(0.0f));
+    CuAssertTrue(tc, vheap_key_from_float(0.0f) < vheap_key_from_float(0.5f));
+    CuAssertTrue(tc, vheap_key_from_float(0.5f) < vheap_key_from_float(3.0f));
+}
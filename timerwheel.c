@@ -0,0 +1,420 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "heap.h"
+#include "timerwheel.h"
+
+#define L0_BITS 8
+#define LN_BITS 6
+#define L0_SIZE (1 << L0_BITS)
+#define LN_SIZE (1 << LN_BITS)
+#define L0_MASK (L0_SIZE - 1)
+#define LN_MASK (LN_SIZE - 1)
+#define NLEVELS 4
+#define NSLOTS (L0_SIZE + (NLEVELS - 1) * LN_SIZE)
+
+/* timers expiring this many ticks ahead or more go to the overflow heap */
+#define RANGE ((uint64_t)1 << (L0_BITS + (NLEVELS - 1) * LN_BITS))
+
+#define NOT_SCHEDULED -1
+#define IN_OVERFLOW -2
+#define IN_EXPIRED -3
+
+struct timerwheel_s
+{
+    /* next tick to be processed; earlier ticks have been polled */
+    uint64_t base;
+    /* timers within the wheel's slots */
+    size_t count;
+    /* timers that have expired but haven't been returned yet */
+    timerwheel_timer_t expired;
+    size_t nexpired;
+    /* far-future timers */
+    heap_t *overflow;
+    /* bit per slot, set if the slot's list is non-empty */
+    uint64_t occupied[NSLOTS / 64];
+    /* list heads; level 0 then each coarser level */
+    timerwheel_timer_t slots[NSLOTS];
+};
+
+static int __expires_cmp(
+    const void *e1,
+    const void *e2,
+    const void *udata __attribute__((__unused__))
+    )
+{
+    const timerwheel_timer_t *t1 = e1;
+
+    const timerwheel_timer_t *t2 = e2;
+
+    return (t2->expires > t1->expires) - (t2->expires < t1->expires);
+}
+
+static void __list_init(timerwheel_timer_t * head)
+{
+    head->next = head->prev = head;
+}
+
+static int __list_is_empty(const timerwheel_timer_t * head)
+{
+    return head->next == head;
+}
+
+static void __list_append(timerwheel_timer_t * head, timerwheel_timer_t * t)
+{
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static void __list_remove(timerwheel_timer_t * t)
+{
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+}
+
+/**
+ * Move all of from's timers onto the end of to */
+static void __list_splice(timerwheel_timer_t * to, timerwheel_timer_t * from)
+{
+    if (__list_is_empty(from))
+        return;
+
+    from->next->prev = to->prev;
+    from->prev->next = to;
+    to->prev->next = from->next;
+    to->prev = from->prev;
+    __list_init(from);
+}
+
+static void __mark(timerwheel_t * tw, const unsigned int slot)
+{
+    tw->occupied[slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+static void __unmark(timerwheel_t * tw, const unsigned int slot)
+{
+    tw->occupied[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+}
+
+/**
+ * Search a circular bitmap for the first set bit at or after start
+ *
+ * @return distance from start to the set bit; nbits if there is none */
+static unsigned int __find_next(const uint64_t *bits, const unsigned int nbits,
+                                const unsigned int start)
+{
+    unsigned int dist;
+
+    for (dist = 0; dist < nbits; )
+    {
+        unsigned int pos = (start + dist) % nbits;
+        uint64_t word = bits[pos / 64] >> (pos % 64);
+
+        if (word)
+            return dist + __builtin_ctzll(word) < nbits ?
+                   dist + __builtin_ctzll(word) : nbits;
+
+        dist += 64 - pos % 64;
+    }
+
+    return nbits;
+}
+
+void timerwheel_timer_init(timerwheel_timer_t * t)
+{
+    t->where = NOT_SCHEDULED;
+}
+
+int timerwheel_timer_is_scheduled(const timerwheel_timer_t * t)
+{
+    return t->where != NOT_SCHEDULED;
+}
+
+timerwheel_t *timerwheel_new(uint64_t now)
+{
+    timerwheel_t *tw = malloc(sizeof(timerwheel_t));
+    unsigned int ii;
+
+    if (!tw)
+        return NULL;
+
+    if (!(tw->overflow = heap_new(__expires_cmp, NULL)))
+    {
+        free(tw);
+        return NULL;
+    }
+    heap_set_item_idx_offset(tw->overflow, offsetof(timerwheel_timer_t, idx));
+
+    tw->base = now;
+    tw->count = 0;
+    tw->nexpired = 0;
+    memset(tw->occupied, 0, sizeof(tw->occupied));
+    __list_init(&tw->expired);
+    for (ii = 0; ii < NSLOTS; ii++)
+        __list_init(&tw->slots[ii]);
+
+    return tw;
+}
+
+void timerwheel_free(timerwheel_t * tw)
+{
+    heap_free(tw->overflow);
+    free(tw);
+}
+
+/**
+ * @return the slot the timer belongs in, relative to the current base;
+ *  expires can't be before base */
+static int __slot(const timerwheel_t * tw, const uint64_t expires)
+{
+    uint64_t delta;
+    unsigned int level;
+
+    delta = expires - tw->base;
+    if (delta < L0_SIZE)
+        return expires & L0_MASK;
+
+    for (level = 1; level < NLEVELS; level++)
+    {
+        unsigned int shift = L0_BITS + level * LN_BITS;
+
+        if (delta < ((uint64_t)1 << shift))
+            return L0_SIZE + (level - 1) * LN_SIZE +
+                   ((expires >> (shift - LN_BITS)) & LN_MASK);
+    }
+
+    return IN_OVERFLOW;
+}
+
+/**
+ * Put an unscheduled timer where it belongs
+ *
+ * @return 0 on success; -1 on failure */
+static int __add(timerwheel_t * tw, timerwheel_timer_t * t)
+{
+    int where;
+
+    /* ticks before base have been polled already */
+    if (t->expires < tw->base)
+    {
+        __list_append(&tw->expired, t);
+        tw->nexpired++;
+        t->where = IN_EXPIRED;
+        return 0;
+    }
+
+    where = __slot(tw, t->expires);
+
+    if (IN_OVERFLOW == where)
+    {
+        if (-1 == heap_offer(&tw->overflow, t))
+            return -1;
+    }
+    else
+    {
+        __list_append(&tw->slots[where], t);
+        __mark(tw, where);
+        tw->count++;
+    }
+
+    t->where = where;
+    return 0;
+}
+
+int timerwheel_schedule(timerwheel_t * tw, timerwheel_timer_t * t,
+                        uint64_t expires)
+{
+    if (timerwheel_timer_is_scheduled(t))
+        timerwheel_cancel(tw, t);
+
+    t->expires = expires;
+    return __add(tw, t);
+}
+
+int timerwheel_cancel(timerwheel_t * tw, timerwheel_timer_t * t)
+{
+    switch (t->where)
+    {
+    case NOT_SCHEDULED:
+        return -1;
+
+    case IN_OVERFLOW:
+        heap_remove_item(tw->overflow, t);
+        break;
+
+    case IN_EXPIRED:
+        __list_remove(t);
+        tw->nexpired--;
+        break;
+
+    default:
+        __list_remove(t);
+        if (__list_is_empty(&tw->slots[t->where]))
+            __unmark(tw, t->where);
+        tw->count--;
+        break;
+    }
+
+    t->where = NOT_SCHEDULED;
+    return 0;
+}
+
+/**
+ * Re-add the timers of a coarse slot; they land in finer levels */
+static void __cascade(timerwheel_t * tw, unsigned int level)
+{
+    unsigned int shift = L0_BITS + (level - 1) * LN_BITS;
+    unsigned int slot;
+    timerwheel_timer_t list;
+
+    slot = L0_SIZE + (level - 1) * LN_SIZE + ((tw->base >> shift) & LN_MASK);
+
+    __list_init(&list);
+    __list_splice(&list, &tw->slots[slot]);
+    __unmark(tw, slot);
+
+    while (!__list_is_empty(&list))
+    {
+        timerwheel_timer_t *t = list.next;
+
+        __list_remove(t);
+        tw->count--;
+        /* can't fail; the timer is within range so it stays in the wheel */
+        __add(tw, t);
+    }
+}
+
+/**
+ * Move overflow timers that are now within range into the wheel */
+static void __migrate_overflow(timerwheel_t * tw)
+{
+    timerwheel_timer_t *t;
+
+    while ((t = heap_peek(tw->overflow)) && t->expires - tw->base < RANGE)
+    {
+        heap_poll(tw->overflow);
+        __add(tw, t);
+    }
+}
+
+/**
+ * Process the tick at base, moving its timers onto the expired list */
+static void __tick(timerwheel_t * tw)
+{
+    unsigned int level;
+
+    /* cascade each level whose period has just rolled over */
+    for (level = 1; level < NLEVELS; level++)
+    {
+        unsigned int shift = L0_BITS + (level - 1) * LN_BITS;
+
+        if (0 != (tw->base & (((uint64_t)1 << shift) - 1)))
+            break;
+        __cascade(tw, level);
+    }
+
+    __migrate_overflow(tw);
+
+    if (!__list_is_empty(&tw->slots[tw->base & L0_MASK]))
+    {
+        timerwheel_timer_t *t;
+
+        for (t = tw->slots[tw->base & L0_MASK].next;
+             t != &tw->slots[tw->base & L0_MASK]; t = t->next)
+        {
+            t->where = IN_EXPIRED;
+            tw->count--;
+            tw->nexpired++;
+        }
+
+        __list_splice(&tw->expired, &tw->slots[tw->base & L0_MASK]);
+        __unmark(tw, tw->base & L0_MASK);
+    }
+
+    tw->base++;
+}
+
+/**
+ * @return the first tick at or after base at which a timer expires, a
+ *  non-empty slot cascades or an overflow timer comes into range */
+static uint64_t __next_event(const timerwheel_t * tw)
+{
+    uint64_t next = UINT64_MAX;
+    timerwheel_timer_t *t;
+    unsigned int level, dist;
+
+    /* level 0 timers are all within the next L0_SIZE ticks */
+    dist = __find_next(tw->occupied, L0_SIZE, tw->base & L0_MASK);
+    if (dist < L0_SIZE)
+        next = tw->base + dist;
+
+    for (level = 1; level < NLEVELS; level++)
+    {
+        unsigned int shift = L0_BITS + (level - 1) * LN_BITS;
+        uint64_t period = (uint64_t)1 << shift;
+        /* first tick at which this level cascades */
+        uint64_t boundary = (tw->base + period - 1) & ~(period - 1);
+
+        dist = __find_next(&tw->occupied[(L0_SIZE + (level - 1) * LN_SIZE) / 64],
+                           LN_SIZE, (boundary >> shift) & LN_MASK);
+        if (dist < LN_SIZE && boundary + dist * period < next)
+            next = boundary + dist * period;
+    }
+
+    if ((t = heap_peek(tw->overflow)))
+    {
+        uint64_t in_range = t->expires - (RANGE - 1);
+
+        if (in_range < tw->base)
+            in_range = tw->base;
+        if (in_range < next)
+            next = in_range;
+    }
+
+    return next;
+}
+
+size_t timerwheel_poll_expired(timerwheel_t * tw, uint64_t now,
+                               timerwheel_timer_t ** out, size_t max)
+{
+    size_t n = 0;
+
+    while (1)
+    {
+        while (n < max && !__list_is_empty(&tw->expired))
+        {
+            timerwheel_timer_t *t = tw->expired.next;
+
+            __list_remove(t);
+            tw->nexpired--;
+            t->where = NOT_SCHEDULED;
+            out[n++] = t;
+        }
+
+        if (n == max || now < tw->base)
+            break;
+
+        /* skip ticks where nothing happens */
+        tw->base = __next_event(tw);
+        if (now < tw->base)
+        {
+            tw->base = now + 1;
+            break;
+        }
+
+        __tick(tw);
+    }
+
+    return n;
+}
+
+size_t timerwheel_count(const timerwheel_t * tw)
+{
+    return tw->count + tw->nexpired + heap_count(tw->overflow);
+}
+
+/*--------------------------------------------------------------79-characters-*/
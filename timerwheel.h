@@ -0,0 +1,97 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A hierarchical timing wheel.
+ *
+ * Scheduling and cancelling a timer are O(1). Time is measured in integer
+ * ticks. Level 0 has a slot per tick for the next 256 ticks. Each of the
+ * three coarser levels has 64 slots, and their timers are cascaded down
+ * as time reaches them. Timers beyond the wheel's range of 2^26 ticks are
+ * kept in a heap_t overflow level and moved into the wheel once they are
+ * within range.
+ *
+ * Timers are intrusive: embed a timerwheel_timer_t in your own struct. */
+typedef struct timerwheel_s timerwheel_t;
+
+/**
+ * A timer. Embed it in your own struct; treat the fields as private. */
+typedef struct timerwheel_timer_s
+{
+    struct timerwheel_timer_s *next;
+    struct timerwheel_timer_s *prev;
+    uint64_t expires;
+    /* index within the overflow heap */
+    size_t idx;
+    /* list the timer is on; or one of the TIMERWHEEL_* values below */
+    int where;
+} timerwheel_timer_t;
+
+/**
+ * Initialise a timer. Required once before the timer is first scheduled,
+ * as scheduling checks whether it is already scheduled, and also makes it
+ * safe to cancel before it has ever been scheduled. */
+void timerwheel_timer_init(timerwheel_timer_t * t);
+
+/**
+ * @return 1 if the timer is scheduled; otherwise 0 */
+int timerwheel_timer_is_scheduled(const timerwheel_timer_t * t);
+
+/**
+ * Create new timing wheel and initialise it.
+ *
+ * malloc()s space for the wheel.
+ *
+ * @param[in] now The current tick
+ * @return initialised wheel; NULL on failure */
+timerwheel_t *timerwheel_new(uint64_t now);
+
+/**
+ * NOTE:
+ *  Does not free timers. */
+void timerwheel_free(timerwheel_t * tw);
+
+/**
+ * Schedule a timer. A timer that is already scheduled is moved.
+ *
+ * The timer must have been initialised with timerwheel_timer_init().
+ *
+ * A timer with expires earlier than the last polled tick fires on the
+ * next poll.
+ *
+ * @param[in] t The timer to schedule
+ * @param[in] expires The tick at which the timer expires
+ * @return 0 on success; -1 on failure */
+int timerwheel_schedule(timerwheel_t * tw, timerwheel_timer_t * t,
+                        uint64_t expires);
+
+/**
+ * Cancel a timer
+ *
+ * @return 0 on success; -1 if the timer isn't scheduled */
+int timerwheel_cancel(timerwheel_t * tw, timerwheel_timer_t * t);
+
+/**
+ * Advance time and remove timers that expire at or before now
+ *
+ * Timers come out in order of expiry tick. If more than max timers have
+ * expired, the rest are returned by the next call.
+ *
+ * Ticks where nothing expires or cascades are skipped, so the cost does
+ * not depend on how much time has passed.
+ *
+ * @param[in] now The current tick; must not go backwards
+ * @param[out] out Array that receives the expired timers
+ * @param[in] max Maximum number of timers to remove
+ * @return number of timers removed */
+size_t timerwheel_poll_expired(timerwheel_t * tw, uint64_t now,
+                               timerwheel_timer_t ** out, size_t max);
+
+/**
+ * @return number of scheduled timers */
+size_t timerwheel_count(const timerwheel_t * tw);
+
+#endif /* TIMERWHEEL_H */
@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vheap.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#define DEFAULT_CAPACITY 64
+
+/* key arrays are aligned for the widest child group */
+#define KEY_ALIGN 64
+
+/* unused slots hold this, so they never win a comparison */
+#define KEY_EMPTY UINT32_MAX
+
+struct vheap_s
+{
+    /* slots in the arrays, including the leading padding */
+    size_t size;
+    /* items within heap */
+    size_t count;
+    unsigned int arity_log2;
+    /* the sift used by vheap_poll() */
+    void (*pushdown) (vheap_t *, size_t);
+    uint32_t *keys;
+    void **items;
+};
+
+/*
+ * Node n lives in slot n + arity - 1. That puts the children of every node
+ * at a slot that is a multiple of the arity, so each group of children is
+ * aligned for one SIMD load.
+ */
+
+static size_t __root(const vheap_t * h)
+{
+    return ((size_t)1 << h->arity_log2) - 1;
+}
+
+static size_t __child_first(const vheap_t * h, size_t slot)
+{
+    return (slot + 1 - __root(h)) << h->arity_log2;
+}
+
+static size_t __parent(const vheap_t * h, size_t slot)
+{
+    return ((slot - __root(h) - 1) >> h->arity_log2) + __root(h);
+}
+
+/**
+ * Move the entry at slot up into its place */
+static void __pushup(vheap_t * h, size_t slot)
+{
+    uint32_t key = h->keys[slot];
+    void *item = h->items[slot];
+
+    while (__root(h) != slot)
+    {
+        size_t parent = __parent(h, slot);
+
+        if (h->keys[parent] <= key)
+            break;
+
+        h->keys[slot] = h->keys[parent];
+        h->items[slot] = h->items[parent];
+        slot = parent;
+    }
+
+    h->keys[slot] = key;
+    h->items[slot] = item;
+}
+
+/**
+ * The sift down shared by every child selection method. select returns the
+ * lane of the first lowest key of an aligned group of children.
+ *
+ * Always inlined, so that each caller gets a copy with select inlined. */
+static inline __attribute__((always_inline))
+void __pushdown_with(vheap_t * h, size_t slot,
+                     unsigned int (*select) (const uint32_t *))
+{
+    size_t end = h->count + __root(h);
+    uint32_t key = h->keys[slot];
+    void *item = h->items[slot];
+
+    while (1)
+    {
+        size_t child = __child_first(h, slot);
+
+        if (child >= end)
+            break;
+
+        child += select(h->keys + child);
+
+        if (key <= h->keys[child])
+            break;
+
+        h->keys[slot] = h->keys[child];
+        h->items[slot] = h->items[child];
+        slot = child;
+    }
+
+    h->keys[slot] = key;
+    h->items[slot] = item;
+}
+
+#define SCALAR_SELECT(n) \
+static inline unsigned int __select_scalar_##n(const uint32_t *keys) \
+{ \
+    unsigned int best = 0, ii; \
+\
+    for (ii = 1; ii < n; ii++) \
+        if (keys[ii] < keys[best]) \
+            best = ii; \
+    return best; \
+} \
+\
+static void __pushdown_scalar_##n(vheap_t * h, size_t slot) \
+{ \
+    __pushdown_with(h, slot, __select_scalar_##n); \
+}
+
+SCALAR_SELECT(4)
+SCALAR_SELECT(8)
+SCALAR_SELECT(16)
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse4.1")))
+static inline unsigned int __select_sse41_4(const uint32_t *keys)
+{
+    __m128i v = _mm_load_si128((const __m128i *)keys);
+    __m128i m;
+
+    /* every lane ends up holding the minimum */
+    m = _mm_min_epu32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    return __builtin_ctz(_mm_movemask_ps(
+                             _mm_castsi128_ps(_mm_cmpeq_epi32(v, m))));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i __min_all_avx2(__m256i m)
+{
+    m = _mm256_min_epu32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    m = _mm256_min_epu32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm256_min_epu32(m, _mm256_permute2x128_si256(m, m, 1));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int __select_avx2_8(const uint32_t *keys)
+{
+    __m256i v = _mm256_load_si256((const __m256i *)keys);
+    __m256i m = __min_all_avx2(v);
+
+    return __builtin_ctz(_mm256_movemask_ps(
+                             _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m))));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int __select_avx2_16(const uint32_t *keys)
+{
+    __m256i lo = _mm256_load_si256((const __m256i *)keys);
+    __m256i hi = _mm256_load_si256((const __m256i *)(keys + 8));
+    __m256i m = __min_all_avx2(_mm256_min_epu32(lo, hi));
+    unsigned int mask;
+
+    mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lo, m)));
+    mask |= _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpeq_epi32(hi, m))) << 8;
+    return __builtin_ctz(mask);
+}
+
+__attribute__((target("sse4.1")))
+static void __pushdown_sse41_4(vheap_t * h, size_t slot)
+{
+    __pushdown_with(h, slot, __select_sse41_4);
+}
+
+__attribute__((target("avx2")))
+static void __pushdown_avx2_8(vheap_t * h, size_t slot)
+{
+    __pushdown_with(h, slot, __select_avx2_8);
+}
+
+__attribute__((target("avx2")))
+static void __pushdown_avx2_16(vheap_t * h, size_t slot)
+{
+    __pushdown_with(h, slot, __select_avx2_16);
+}
+#endif
+
+/**
+ * @return the SIMD sift for the heap's arity; NULL if the CPU can't run
+ *  one */
+static void (*__pushdown_simd(const vheap_t * h)) (vheap_t *, size_t)
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    switch (h->arity_log2)
+    {
+    case 2:
+        if (__builtin_cpu_supports("sse4.1"))
+            return __pushdown_sse41_4;
+        break;
+    case 3:
+        if (__builtin_cpu_supports("avx2"))
+            return __pushdown_avx2_8;
+        break;
+    case 4:
+        if (__builtin_cpu_supports("avx2"))
+            return __pushdown_avx2_16;
+        break;
+    }
+#else
+    (void)h;
+#endif
+    return NULL;
+}
+
+static void (*__pushdown_scalar(const vheap_t * h)) (vheap_t *, size_t)
+{
+    switch (h->arity_log2)
+    {
+    case 2:
+        return __pushdown_scalar_4;
+    case 3:
+        return __pushdown_scalar_8;
+    default:
+        return __pushdown_scalar_16;
+    }
+}
+
+/**
+ * Allocate arrays of size slots, copying over the first count slots in use
+ *
+ * @return 0 on success; -1 otherwise, leaving the heap untouched */
+static int __resize(vheap_t * h, size_t size)
+{
+    size_t used = h->count + __root(h);
+    uint32_t *keys;
+    void **items;
+    size_t ii;
+
+    if (SIZE_MAX / sizeof(*items) < size)
+        return -1;
+
+    if (0 != posix_memalign((void **)&keys, KEY_ALIGN, size * sizeof(*keys)))
+        return -1;
+
+    if (!(items = malloc(size * sizeof(*items))))
+    {
+        free(keys);
+        return -1;
+    }
+
+    if (h->keys)
+    {
+        memcpy(keys, h->keys, used * sizeof(*keys));
+        memcpy(items, h->items, used * sizeof(*items));
+    }
+
+    for (ii = used; ii < size; ii++)
+        keys[ii] = KEY_EMPTY;
+
+    free(h->keys);
+    free(h->items);
+    h->keys = keys;
+    h->items = items;
+    h->size = size;
+    return 0;
+}
+
+vheap_t *vheap_new(unsigned int arity)
+{
+    vheap_t *h;
+
+    if (4 != arity && 8 != arity && 16 != arity)
+        return NULL;
+
+    if (!(h = malloc(sizeof(vheap_t))))
+        return NULL;
+
+    h->count = 0;
+    h->size = 0;
+    h->keys = NULL;
+    h->items = NULL;
+    for (h->arity_log2 = 0; (1u << h->arity_log2) < arity; h->arity_log2++)
+        ;
+
+    if (-1 == __resize(h, DEFAULT_CAPACITY))
+    {
+        free(h);
+        return NULL;
+    }
+
+    if (!(h->pushdown = __pushdown_simd(h)))
+        h->pushdown = __pushdown_scalar(h);
+
+    return h;
+}
+
+void vheap_free(vheap_t * h)
+{
+    free(h->keys);
+    free(h->items);
+    free(h);
+}
+
+int vheap_set_simd(vheap_t * h, int enable)
+{
+    void (*pushdown) (vheap_t *, size_t);
+
+    pushdown = enable ? __pushdown_simd(h) : __pushdown_scalar(h);
+    if (!pushdown)
+        return -1;
+
+    h->pushdown = pushdown;
+    return 0;
+}
+
+int vheap_simd(const vheap_t * h)
+{
+    return h->pushdown != __pushdown_scalar(h);
+}
+
+int vheap_offer(vheap_t * h, uint32_t key, void *item)
+{
+    size_t slot = h->count + __root(h);
+
+    /* sizes stay multiples of the arity, so every child group fits */
+    if (slot == h->size &&
+        (SIZE_MAX / 2 < h->size || -1 == __resize(h, h->size * 2)))
+        return -1;
+
+    h->keys[slot] = key;
+    h->items[slot] = item;
+    h->count++;
+    __pushup(h, slot);
+    return 0;
+}
+
+void *vheap_poll(vheap_t * h, uint32_t *key)
+{
+    size_t root = __root(h), last;
+    void *item;
+
+    if (0 == h->count)
+        return NULL;
+
+    item = h->items[root];
+    if (key)
+        *key = h->keys[root];
+
+    h->count--;
+    last = h->count + root;
+    h->keys[root] = h->keys[last];
+    h->items[root] = h->items[last];
+    h->keys[last] = KEY_EMPTY;
+
+    if (1 < h->count)
+        h->pushdown(h, root);
+
+    return item;
+}
+
+void *vheap_peek(const vheap_t * h, uint32_t *key)
+{
+    if (0 == h->count)
+        return NULL;
+
+    if (key)
+        *key = h->keys[__root(h)];
+
+    return h->items[__root(h)];
+}
+
+void vheap_clear(vheap_t * h)
+{
+    size_t ii;
+
+    for (ii = __root(h); ii < h->count + __root(h); ii++)
+        h->keys[ii] = KEY_EMPTY;
+    h->count = 0;
+}
+
+size_t vheap_count(const vheap_t * h)
+{
+    return h->count;
+}
+
+/*--------------------------------------------------------------79-characters-*/
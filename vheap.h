@@ -0,0 +1,94 @@
+#ifndef VHEAP_H
+#define VHEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A wide heap of 32-bit keys with SIMD child selection.
+ *
+ * Keys are kept in their own contiguous, aligned array next to the item
+ * array, and each node's children are aligned as a group. Sifting down
+ * finds the lowest of 4, 8 or 16 children with a single SIMD min
+ * reduction per level (SSE4.1 or AVX2, picked at run time) rather than a
+ * scan, which makes very wide and therefore shallow heaps cheap. CPUs
+ * without these fall back to a scalar scan that gives bit-identical
+ * results.
+ *
+ * The item with the lowest key is at the top. Of children with equal keys
+ * the first is chosen, with or without SIMD. */
+typedef struct vheap_s vheap_t;
+
+/**
+ * Create new heap and initialise it.
+ *
+ * malloc()s space for heap.
+ *
+ * @param[in] arity Number of children per node; 4, 8 or 16
+ * @return initialised heap; NULL on failure or if arity is invalid */
+vheap_t *vheap_new(unsigned int arity);
+
+/**
+ * NOTE:
+ *  Does not free items. */
+void vheap_free(vheap_t * hp);
+
+/**
+ * Choose between the SIMD and the scalar sift. SIMD is on by default when
+ * the CPU supports it.
+ *
+ * @param[in] enable Non-zero to use SIMD
+ * @return 0 on success; -1 if SIMD was asked for but isn't supported */
+int vheap_set_simd(vheap_t * hp, int enable);
+
+/**
+ * @return non-zero if the heap is using SIMD */
+int vheap_simd(const vheap_t * hp);
+
+/**
+ * Add item
+ *
+ * NOTE:
+ *  The arrays are reallocated as needed; the heap itself never moves.
+ *
+ * @param[in] key The item's priority; lower keys are polled first
+ * @param[in] item The item to be added
+ * @return 0 on success; -1 on failure */
+int vheap_offer(vheap_t * hp, uint32_t key, void *item);
+
+/**
+ * Remove the item with the lowest key
+ *
+ * @param[out] key Set to the item's key; may be NULL
+ * @return top item; NULL if the heap is empty */
+void *vheap_poll(vheap_t * hp, uint32_t *key);
+
+/**
+ * @param[out] key Set to the top item's key; may be NULL
+ * @return top item of the heap; NULL if the heap is empty */
+void *vheap_peek(const vheap_t * hp, uint32_t *key);
+
+/**
+ * Clear all items
+ *
+ * NOTE:
+ *  Does not free items. */
+void vheap_clear(vheap_t * hp);
+
+/**
+ * @return number of items in heap */
+size_t vheap_count(const vheap_t * hp);
+
+/**
+ * Map a float onto an unsigned key with the same ordering.
+ *
+ * NaNs sort after +inf (or before -inf if their sign bit is set). */
+static inline uint32_t vheap_key_from_float(float key)
+{
+    union { float f; uint32_t u; } v;
+
+    v.f = key;
+    return v.u >> 31 ? ~v.u : v.u | ((uint32_t)1 << 31);
+}
+
+#endif /* VHEAP_H */